@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "arquivo.h"
+#include "vc_log.h"
+
+static const uint32_t VERSAO_ARQUIVO = 1;
+static const uint64_t ALINHAMENTO_FRAME = 64;
+
+GravadorArquivo::GravadorArquivo(const char* nome) {
+    ficheiro = fopen(nome, "wb");
+    if (ficheiro == NULL) {
+        vc_log(VC_LOG_ERRO, "Erro ao criar o arquivo de frames '%s'!\n", nome);
+        return;
+    }
+
+    // Cabeçalho provisório: o definitivo é escrito ao fechar
+    CabecalhoArquivo cabecalho = {};
+    if (fwrite(&cabecalho, sizeof(cabecalho), 1, ficheiro) != 1) {
+        vc_log(VC_LOG_ERRO, "Erro ao escrever no arquivo de frames '%s'!\n", nome);
+        fclose(ficheiro);
+        ficheiro = NULL;
+        return;
+    }
+    posicao = sizeof(cabecalho);
+}
+
+GravadorArquivo::~GravadorArquivo() {
+    fechar();
+}
+
+bool GravadorArquivo::acrescentar(const unsigned char* dados, int largura, int altura, int canais, int bytesperline) {
+    static const unsigned char zeros[ALINHAMENTO_FRAME] = { 0 };
+
+    if (ficheiro == NULL || dados == NULL || largura <= 0 || altura <= 0 || canais <= 0) return false;
+
+    // Alinhar o início do frame
+    size_t enchimento = (size_t)((ALINHAMENTO_FRAME - posicao % ALINHAMENTO_FRAME) % ALINHAMENTO_FRAME);
+    if (enchimento > 0 && fwrite(zeros, 1, enchimento, ficheiro) != enchimento) return false;
+    posicao += enchimento;
+
+    // Linhas contíguas: uma única escrita
+    size_t linha = (size_t)largura * canais;
+    if ((size_t)bytesperline == linha) {
+        if (fwrite(dados, linha, altura, ficheiro) != (size_t)altura) return false;
+    } else {
+        for (int y = 0; y < altura; y++) {
+            if (fwrite(&dados[(size_t)y * bytesperline], linha, 1, ficheiro) != 1) return false;
+        }
+    }
+
+    EntradaArquivo entrada = { posicao, largura, altura, canais, 0 };
+    indice.push_back(entrada);
+    posicao += linha * altura;
+
+    return true;
+}
+
+bool GravadorArquivo::fechar() {
+    if (ficheiro == NULL) return false;
+
+    static const unsigned char zeros[8] = { 0 };
+    bool ok = true;
+
+    // Índice alinhado a 8 bytes, depois dos dados
+    size_t enchimento = (size_t)((8 - posicao % 8) % 8);
+    ok = ok && (enchimento == 0 || fwrite(zeros, 1, enchimento, ficheiro) == enchimento);
+
+    CabecalhoArquivo cabecalho = {};
+    memcpy(cabecalho.assinatura, "VCFA", 4);
+    cabecalho.versao = VERSAO_ARQUIVO;
+    cabecalho.numFrames = (uint32_t)indice.size();
+    cabecalho.posIndice = posicao + enchimento;
+
+    ok = ok && (indice.empty() || fwrite(indice.data(), sizeof(EntradaArquivo), indice.size(), ficheiro) == indice.size());
+    ok = ok && fseek(ficheiro, 0, SEEK_SET) == 0;
+    ok = ok && fwrite(&cabecalho, sizeof(cabecalho), 1, ficheiro) == 1;
+    ok = (fclose(ficheiro) == 0) && ok;
+    ficheiro = NULL;
+
+    if (!ok) vc_log(VC_LOG_ERRO, "Erro ao fechar o arquivo de frames!\n");
+    return ok;
+}
+
+ArquivoFrames::ArquivoFrames(const char* nome) {
+    base = (unsigned char*)vc_file_map(nome, &tamanho);
+    if (base == NULL) {
+        vc_log(VC_LOG_ERRO, "Não foi possível abrir o arquivo de frames '%s'!\n", nome);
+        return;
+    }
+
+    // Validar o cabeçalho e o índice (os frames não são tocados até serem pedidos)
+    bool valido = tamanho >= sizeof(CabecalhoArquivo);
+    const CabecalhoArquivo* cabecalho = (const CabecalhoArquivo*)base;
+    valido = valido && memcmp(cabecalho->assinatura, "VCFA", 4) == 0 && cabecalho->versao == VERSAO_ARQUIVO;
+    valido = valido && cabecalho->posIndice <= tamanho &&
+             (tamanho - cabecalho->posIndice) / sizeof(EntradaArquivo) >= cabecalho->numFrames;
+
+    if (valido) {
+        indice = (const EntradaArquivo*)(base + cabecalho->posIndice);
+        numFrames = (int)cabecalho->numFrames;
+
+        for (int i = 0; i < numFrames && valido; i++) {
+            const EntradaArquivo& e = indice[i];
+            valido = e.largura > 0 && e.altura > 0 && e.canais > 0 && e.posicao <= tamanho &&
+                     (uint64_t)e.largura * e.altura * e.canais <= tamanho - e.posicao;
+        }
+    }
+
+    if (!valido) {
+        vc_log(VC_LOG_ERRO, "Arquivo de frames '%s' inválido ou incompleto!\n", nome);
+        vc_file_unmap(base, tamanho);
+        base = NULL;
+        indice = NULL;
+        numFrames = 0;
+    }
+}
+
+ArquivoFrames::~ArquivoFrames() {
+    vc_file_unmap(base, tamanho);
+}
+
+bool ArquivoFrames::frame(int i, IVC* vista) const {
+    if (base == NULL || vista == NULL || i < 0 || i >= numFrames) return false;
+
+    const EntradaArquivo& e = indice[i];
+    vista->data = base + e.posicao;
+    vista->width = e.largura;
+    vista->height = e.altura;
+    vista->channels = e.canais;
+    vista->levels = 255;
+    vista->bytesperline = e.largura * e.canais;
+
+    return true;
+}
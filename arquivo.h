@@ -0,0 +1,86 @@
+#ifndef ARQUIVO_H
+#define ARQUIVO_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "vc.h"
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//        ARQUIVO DE FRAMES DESCODIFICADOS (GRAVAR E REPETIR)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// Os frames são descodificados uma única vez e guardados em bruto num ficheiro indexado;
+// a repetição mapeia o ficheiro em memória e entrega vistas IVC sobre o mapeamento (sem
+// descodificação nem cópia), para medir a cadeia de processamento isoladamente.
+//
+// Formato (inteiros little-endian, na ordem nativa das máquinas x86):
+//   cabeçalho (32 bytes): "VCFA", versão, número de frames, reservado, posição do índice
+//   dados: os frames em bruto (largura * canais bytes por linha), cada um alinhado a 64 bytes
+//   índice: por frame, a posição dos dados, largura, altura e canais
+
+struct CabecalhoArquivo {
+    char assinatura[4];                 // "VCFA"
+    uint32_t versao;
+    uint32_t numFrames;
+    uint32_t reservado;
+    uint64_t posIndice;
+    uint64_t reservado2;
+};
+
+struct EntradaArquivo {
+    uint64_t posicao;
+    int32_t largura, altura, canais;
+    int32_t reservado;
+};
+
+// Gravação: os frames são acrescentados ao ficheiro; o índice é escrito ao fechar
+class GravadorArquivo {
+public:
+    explicit GravadorArquivo(const char* ficheiro);
+    ~GravadorArquivo();
+
+    GravadorArquivo(const GravadorArquivo&) = delete;
+    GravadorArquivo& operator=(const GravadorArquivo&) = delete;
+
+    bool aberto() const { return ficheiro != NULL; }
+    int frames() const { return (int)indice.size(); }
+
+    // Acrescenta um frame (bytesperline pode incluir enchimento, que não é gravado)
+    bool acrescentar(const unsigned char* dados, int largura, int altura, int canais, int bytesperline);
+
+    // Escreve o índice e o cabeçalho definitivo (chamado também pelo destrutor)
+    bool fechar();
+
+private:
+    FILE* ficheiro = NULL;
+    uint64_t posicao = 0;
+    std::vector<EntradaArquivo> indice;
+};
+
+// Repetição: o ficheiro é mapeado em memória e cada frame é uma vista IVC sobre o mapeamento
+class ArquivoFrames {
+public:
+    explicit ArquivoFrames(const char* ficheiro);
+    ~ArquivoFrames();
+
+    ArquivoFrames(const ArquivoFrames&) = delete;
+    ArquivoFrames& operator=(const ArquivoFrames&) = delete;
+
+    bool aberto() const { return base != NULL; }
+    int frames() const { return numFrames; }
+
+    // Preenche a vista com o frame i (os dados pertencem ao mapeamento: não libertar)
+    bool frame(int i, IVC* vista) const;
+
+private:
+    unsigned char* base = NULL;
+    size_t tamanho = 0;
+    const EntradaArquivo* indice = NULL;
+    int numFrames = 0;
+};
+
+#endif
@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <string.h>
+#include <filesystem>
+#include <opencv2/opencv.hpp>
+
+#include "depuracao.h"
+#include "vc_log.h"
+
+GravadorDepuracao::GravadorDepuracao(const Opcoes& opcoes) : opcoes(opcoes) {
+    if (!ativo()) return;
+
+    if (this->opcoes.cadaN < 1) this->opcoes.cadaN = 1;
+    if (this->opcoes.capacidadeFila < 1) this->opcoes.capacidadeFila = 1;
+
+    // Criar a pasta (se faltar) e confirmar que aceita ficheiros antes de arrancar a thread
+    std::error_code erro;
+    std::filesystem::create_directories(this->opcoes.pasta, erro);
+    std::string teste = this->opcoes.pasta + "/.depuracao";
+    FILE* ficheiro = fopen(teste.c_str(), "wb");
+    if (ficheiro == NULL) {
+        vc_log(VC_LOG_ERRO, "A pasta de depuração '%s' não existe nem pôde ser criada, ou não aceita escrita!\n",
+               this->opcoes.pasta.c_str());
+        this->opcoes.pasta.clear();
+        falha = true;
+        return;
+    }
+    fclose(ficheiro);
+    remove(teste.c_str());
+
+    thread = std::thread(&GravadorDepuracao::executar, this);
+}
+
+GravadorDepuracao::~GravadorDepuracao() {
+    if (thread.joinable()) {
+        // Escrever o que ainda está na fila antes de terminar
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            terminar = true;
+        }
+        condicao.notify_one();
+        thread.join();
+    }
+
+    for (IVC* imagem : livres) vc_image_free(imagem);
+}
+
+bool GravadorDepuracao::submeter(int nframe, const IVC* imagem, const char* nome, bool anomalia) {
+    if (!ativo() || imagem == NULL) return false;
+
+    // Amostragem: um frame em cada N e/ou apenas frames com anomalias
+    if (nframe % opcoes.cadaN != 0) return false;
+    if (opcoes.soAnomalias && !anomalia) return false;
+
+    IVC* copia = NULL;
+    bool alocar = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // Reutilizar um buffer livre com as mesmas dimensões
+        for (size_t i = 0; i < livres.size(); i++) {
+            IVC* candidato = livres[i];
+            if (candidato->width == imagem->width && candidato->height == imagem->height &&
+                candidato->channels == imagem->channels) {
+                copia = candidato;
+                livres.erase(livres.begin() + i);
+                break;
+            }
+        }
+
+        if (copia == NULL) {
+            if (numBuffers < opcoes.capacidadeFila) {
+                numBuffers++;
+                alocar = true;
+            } else if (!livres.empty()) {
+                // Buffer livre com outras dimensões: substituí-lo
+                vc_image_free(livres.back());
+                livres.pop_back();
+                alocar = true;
+            } else {
+                // Fila cheia: descartar
+                numDescartadas++;
+                return false;
+            }
+        }
+    }
+
+    if (alocar) {
+        copia = vc_image_new(imagem->width, imagem->height, imagem->channels, imagem->levels);
+        if (copia == NULL) {
+            std::lock_guard<std::mutex> lock(mutex);
+            numBuffers--;
+            numDescartadas++;
+            return false;
+        }
+    }
+
+    copia->levels = imagem->levels;
+    for (int y = 0; y < imagem->height; y++) {
+        memcpy(&copia->data[y * copia->bytesperline], &imagem->data[y * imagem->bytesperline], imagem->width * imagem->channels);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Pedido pedido;
+        pedido.nframe = nframe;
+        snprintf(pedido.nome, sizeof(pedido.nome), "%s", nome);
+        pedido.imagem = copia;
+        fila.push_back(pedido);
+    }
+    condicao.notify_one();
+
+    return true;
+}
+
+void GravadorDepuracao::executar() {
+    for (;;) {
+        Pedido pedido;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condicao.wait(lock, [this] { return terminar || !fila.empty(); });
+            if (fila.empty()) return;
+            pedido = fila.front();
+            fila.pop_front();
+        }
+
+        gravar(pedido);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        livres.push_back(pedido.imagem);
+    }
+}
+
+void GravadorDepuracao::gravar(const Pedido& pedido) {
+    char ficheiro[512];
+    IVC* imagem = pedido.imagem;
+    bool ok;
+
+    if (opcoes.formato == FORMATO_PNG) {
+        snprintf(ficheiro, sizeof(ficheiro), "%s/%s_%06d.png", opcoes.pasta.c_str(), pedido.nome, pedido.nframe);
+        int tipo = (imagem->channels == 3) ? CV_8UC3 : CV_8UC1;
+        ok = cv::imwrite(ficheiro, cv::Mat(imagem->height, imagem->width, tipo, imagem->data, imagem->bytesperline));
+    } else {
+        snprintf(ficheiro, sizeof(ficheiro), "%s/%s_%06d.%s", opcoes.pasta.c_str(), pedido.nome, pedido.nframe,
+                 (imagem->channels == 3) ? "ppm" : "pgm");
+        ok = vc_write_image(ficheiro, imagem) != 0;
+    }
+
+    if (ok) numGravadas++;
+    else vc_log(VC_LOG_ERRO, "Erro ao gravar a imagem de depuração '%s'!\n", ficheiro);
+}
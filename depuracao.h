@@ -0,0 +1,75 @@
+#ifndef DEPURACAO_H
+#define DEPURACAO_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+extern "C" {
+#include "vc.h"
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//          GRAVAÇÃO ASSÍNCRONA DE IMAGENS DE DEPURAÇÃO
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// As imagens submetidas são copiadas para buffers de um conjunto fixo e escritas
+// em disco por uma thread própria. Se não houver buffer livre (fila cheia), a imagem
+// é descartada: o ciclo de processamento nunca espera pelo disco.
+class GravadorDepuracao {
+public:
+    enum Formato { FORMATO_PGM, FORMATO_PNG };
+
+    struct Opcoes {
+        std::string pasta;              // Pasta de destino (vazia = desativado)
+        int cadaN = 1;                  // Gravar um frame em cada N
+        bool soAnomalias = false;       // Gravar apenas frames com anomalias
+        Formato formato = FORMATO_PGM;  // PGM (vc_write_image, sem compressão) ou PNG
+        int capacidadeFila = 8;         // Número máximo de imagens à espera
+    };
+
+    explicit GravadorDepuracao(const Opcoes& opcoes);
+    ~GravadorDepuracao();
+
+    GravadorDepuracao(const GravadorDepuracao&) = delete;
+    GravadorDepuracao& operator=(const GravadorDepuracao&) = delete;
+
+    bool ativo() const { return !opcoes.pasta.empty(); }
+
+    // A pasta pedida não existe nem pôde ser criada, ou não aceita escrita (o gravador fica desativado)
+    bool falhou() const { return falha; }
+
+    // Aplica a amostragem e, se o frame for escolhido, copia a imagem para a fila.
+    // Devolve true se a imagem ficou na fila.
+    bool submeter(int nframe, const IVC* imagem, const char* nome, bool anomalia);
+
+    int gravadas() const { return numGravadas; }
+    int descartadas() const { return numDescartadas; }
+
+private:
+    struct Pedido {
+        int nframe;
+        char nome[64];                  // Sem alocação por imagem submetida
+        IVC* imagem;
+    };
+
+    void executar();
+    void gravar(const Pedido& pedido);
+
+    Opcoes opcoes;
+    std::vector<IVC*> livres;           // Buffers disponíveis
+    int numBuffers = 0;                 // Buffers alocados (no máximo capacidadeFila)
+    std::deque<Pedido> fila;            // Imagens à espera de escrita
+    std::mutex mutex;
+    std::condition_variable condicao;
+    bool terminar = false;
+    bool falha = false;
+    std::thread thread;
+    std::atomic<int> numGravadas{0};
+    std::atomic<int> numDescartadas{0};
+};
+
+#endif
@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#include "fonte.h"
+#include "vc_log.h"
+
+FonteFrames::FonteFrames(const Opcoes& opcoes) : opcoes(opcoes) {
+    if (this->opcoes.formato == FORMATO_BGR && (this->opcoes.largura <= 0 || this->opcoes.altura <= 0)) {
+        vc_log(VC_LOG_ERRO, "Fonte de frames: dimensões BGR inválidas (%dx%d)!\n", this->opcoes.largura, this->opcoes.altura);
+        return;
+    }
+    if (this->opcoes.numBuffers < 1) this->opcoes.numBuffers = 1;
+
+    if (this->opcoes.caminho == "-") {
+#ifdef _WIN32
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        ficheiro = stdin;
+    } else {
+        // Um FIFO bloqueia aqui até o processo que escreve o abrir
+        ficheiro = fopen(this->opcoes.caminho.c_str(), "rb");
+        fecharFicheiro = true;
+        if (ficheiro == NULL) {
+            vc_log(VC_LOG_ERRO, "Fonte de frames: não foi possível abrir '%s'!\n", this->opcoes.caminho.c_str());
+            return;
+        }
+    }
+
+    // Os buffers só são alocados quando se conhecem as dimensões do primeiro frame
+    livres.assign(this->opcoes.numBuffers, NULL);
+
+    thread = std::thread(&FonteFrames::executar, this);
+}
+
+FonteFrames::~FonteFrames() {
+    if (thread.joinable()) {
+        // A thread termina depois de acabar a leitura em curso
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            terminar = true;
+        }
+        condicao.notify_all();
+        thread.join();
+    }
+
+    for (IVC* frame : livres) vc_image_free(frame);
+    for (IVC* frame : prontos) vc_image_free(frame);
+
+    if (fecharFicheiro && ficheiro != NULL) fclose(ficheiro);
+}
+
+IVC* FonteFrames::obter() {
+    if (!aberta()) return NULL;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    condicao.wait(lock, [this] { return fim || !prontos.empty(); });
+    if (prontos.empty()) return NULL;
+
+    IVC* frame = prontos.front();
+    prontos.pop_front();
+    return frame;
+}
+
+void FonteFrames::devolver(IVC* frame) {
+    if (frame == NULL) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        livres.push_back(frame);
+    }
+    condicao.notify_all();
+}
+
+void FonteFrames::executar() {
+    for (;;) {
+        IVC* frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condicao.wait(lock, [this] { return terminar || !livres.empty(); });
+            if (terminar) return;
+            frame = livres.back();
+            livres.pop_back();
+        }
+
+        bool ok = lerFrame(frame);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (ok) prontos.push_back(frame);
+            else {
+                livres.push_back(frame);
+                fim = true;
+            }
+        }
+        condicao.notify_all();
+
+        if (!ok) return;
+    }
+}
+
+// Lê o próximo frame para o buffer (realocado se as dimensões mudarem); false no fim do fluxo
+bool FonteFrames::lerFrame(IVC*& frame) {
+    if (opcoes.formato == FORMATO_NETPBM) return lerNetpbm(frame);
+
+    if (frame == NULL) {
+        frame = vc_image_new(opcoes.largura, opcoes.altura, 3, 255);
+        if (frame == NULL) {
+            vc_log(VC_LOG_ERRO, "Fonte de frames: erro ao alocar memória!\n");
+            return false;
+        }
+    }
+
+    // BGR em bruto: leitura direta para o buffer
+    return fread(frame->data, frame->bytesperline, frame->height, ficheiro) == (size_t)frame->height;
+}
+
+bool FonteFrames::lerNetpbm(IVC*& frame) {
+    char tok[20];
+    int channels, width, height, levels;
+
+    // Cabeçalho da próxima imagem (um token vazio no início indica o fim do fluxo)
+    netpbm_get_token(ficheiro, tok, sizeof(tok));
+    if (tok[0] == 0) return false;
+
+    if (strcmp(tok, "P5") == 0) channels = 1;
+    else if (strcmp(tok, "P6") == 0) channels = 3;
+    else {
+        vc_log(VC_LOG_ERRO, "Fonte de frames: formato '%s' não suportado (P5 ou P6)!\n", tok);
+        return false;
+    }
+
+    if (sscanf(netpbm_get_token(ficheiro, tok, sizeof(tok)), "%d", &width) != 1 ||
+        sscanf(netpbm_get_token(ficheiro, tok, sizeof(tok)), "%d", &height) != 1 ||
+        sscanf(netpbm_get_token(ficheiro, tok, sizeof(tok)), "%d", &levels) != 1 ||
+        width <= 0 || height <= 0 || levels <= 0 || levels > 255) {
+        vc_log(VC_LOG_ERRO, "Fonte de frames: cabeçalho NetPBM inválido!\n");
+        return false;
+    }
+
+    if (frame == NULL || frame->width != width || frame->height != height || frame->channels != channels) {
+        vc_image_free(frame);
+        frame = vc_image_new(width, height, channels, 255);
+        if (frame == NULL) {
+            vc_log(VC_LOG_ERRO, "Fonte de frames: erro ao alocar memória!\n");
+            return false;
+        }
+    }
+
+    int n = width * height;
+    unsigned char* data = frame->data;
+
+    if (channels == 3) {
+        if (fread(data, 3, n, ficheiro) != (size_t)n) return false;
+
+        // PPM é RGB: trocar para BGR
+        for (int i = 0; i < n * 3; i += 3) {
+            unsigned char r = data[i];
+            data[i] = data[i + 2];
+            data[i + 2] = r;
+        }
+    } else {
+        // PGM: leitura direta, mantendo 1 canal
+        if (fread(data, 1, n, ficheiro) != (size_t)n) return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,65 @@
+#ifndef FONTE_H
+#define FONTE_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+extern "C" {
+#include "vc.h"
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//        FONTE DE FRAMES A PARTIR DE UM FLUXO (STDIN/FIFO)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// Lê frames BGR em bruto (dimensões conhecidas) ou imagens P5/P6 concatenadas da entrada
+// padrão, de um FIFO ou de um ficheiro. Uma thread própria lê diretamente para um conjunto
+// fixo de buffers IVC (por omissão 2: enquanto um frame é processado, o seguinte é lido).
+// Os frames P6 e BGR em bruto são entregues em BGR com 3 canais, como os do cv::VideoCapture;
+// os P5 ficam com 1 canal (cinzento), que a segmentação usa diretamente.
+class FonteFrames {
+public:
+    enum Formato { FORMATO_NETPBM, FORMATO_BGR };
+
+    struct Opcoes {
+        std::string caminho;                // Ficheiro ou FIFO ("-" = entrada padrão)
+        Formato formato = FORMATO_NETPBM;   // P5/P6 concatenados ou BGR em bruto
+        int largura = 0, altura = 0;        // Dimensões dos frames BGR em bruto
+        int numBuffers = 2;                 // Buffers em circulação (2 = leitura dupla)
+    };
+
+    explicit FonteFrames(const Opcoes& opcoes);
+    ~FonteFrames();
+
+    FonteFrames(const FonteFrames&) = delete;
+    FonteFrames& operator=(const FonteFrames&) = delete;
+
+    bool aberta() const { return ficheiro != NULL; }
+
+    // Espera pelo próximo frame; devolve NULL no fim do fluxo ou em caso de erro.
+    // O buffer pertence à fonte e tem de ser devolvido com devolver() depois de usado.
+    IVC* obter();
+    void devolver(IVC* frame);
+
+private:
+    void executar();
+    bool lerFrame(IVC*& frame);
+    bool lerNetpbm(IVC*& frame);
+
+    Opcoes opcoes;
+    FILE* ficheiro = NULL;
+    bool fecharFicheiro = false;
+    std::vector<IVC*> livres;           // Buffers disponíveis (NULL = ainda não alocado)
+    std::deque<IVC*> prontos;           // Frames lidos à espera de processamento
+    std::mutex mutex;
+    std::condition_variable condicao;
+    bool fim = false;                   // Fim do fluxo (ou erro de leitura)
+    bool terminar = false;
+    std::thread thread;
+};
+
+#endif
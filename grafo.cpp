@@ -0,0 +1,420 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "grafo.h"
+#include "vc_kernels.hpp"
+#include "vc_log.h"
+
+// Função para remover os espaços no início e no fim de um texto
+static std::string aparar(const std::string& texto) {
+    size_t a = texto.find_first_not_of(" \t\r\n");
+    if (a == std::string::npos) return std::string();
+    size_t b = texto.find_last_not_of(" \t\r\n");
+    return texto.substr(a, b - a + 1);
+}
+
+GrafoProcessamento::GrafoProcessamento() {
+    registarTiposBase();
+}
+
+GrafoProcessamento::~GrafoProcessamento() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        terminar = true;
+    }
+    condicao.notify_all();
+    for (std::thread& t : trabalhadores) t.join();
+
+    libertarBuffers();
+}
+
+// Ciclo de um trabalhador: executa etapas pedidas até o grafo ser destruído
+void GrafoProcessamento::trabalhar() {
+    for (;;) {
+        Pedido pedido;
+        IVC* entrada;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condicao.wait(lock, [this] { return terminar || !pedidos.empty(); });
+            if (terminar) return;
+            pedido = pedidos.front();
+            pedidos.pop_front();
+            entrada = entradaAtual;
+        }
+
+        char resultado = executarEtapa(pedido.etapa, entrada);
+
+        bool ultimo;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            *pedido.resultado = resultado;
+            ultimo = --pendentes == 0;
+        }
+        if (ultimo) concluido.notify_one();
+    }
+}
+
+int GrafoProcessamento::parametro(const Parametros& parametros, const char* nome, int omissao) {
+    Parametros::const_iterator it = parametros.find(nome);
+    return it != parametros.end() ? it->second : omissao;
+}
+
+void GrafoProcessamento::registarTipo(const std::string& tipo, int numEntradas, int canaisSaida, Funcao funcao) {
+    Tipo t;
+    t.numEntradas = numEntradas;
+    t.canaisSaida = canaisSaida;
+    t.funcao = funcao;
+    tipos[tipo] = t;
+}
+
+// Tipos de etapa disponíveis em qualquer grafo (todas as saídas têm as dimensões do frame)
+void GrafoProcessamento::registarTiposBase() {
+    // Conversão para cinzento (uma entrada com 1 canal é copiada)
+    registarTipo("cinzento", 1, 1, [](const std::vector<IVC*>& e, IVC* s, const Parametros&) {
+        if (e[0]->channels == 3) return vc_rgb_to_gray(e[0], s) != 0;
+        if (e[0]->channels != 1) return false;
+        for (int y = 0; y < s->height; y++) {
+            memcpy(&s->data[y * s->bytesperline], &e[0]->data[y * e[0]->bytesperline], s->width);
+        }
+        return true;
+    });
+
+    // Filtro gaussiano (a margem replica os píxeis da borda: o buffer pode vir de outra etapa)
+    registarTipo("gaussiano", 1, 1, [](const std::vector<IVC*>& e, IVC* s, const Parametros& p) {
+        return vc::gaussian_blur(e[0], s, parametro(p, "raio", 2), vc::Borda::Replicar) != 0;
+    });
+
+    // Binarização adaptativa (a margem que a janela não cobre fica a preto)
+    registarTipo("limiar_adaptativo", 1, 1, [](const std::vector<IVC*>& e, IVC* s, const Parametros& p) {
+        memset(s->data, 0, s->bytesperline * s->height);
+        return vc::gray_to_binary_adaptive_mean(e[0], s, parametro(p, "janela", 15), parametro(p, "deslocamento", 20)) != 0;
+    });
+
+    // Binarização pela média global
+    registarTipo("limiar_media", 1, 1, [](const std::vector<IVC*>& e, IVC* s, const Parametros&) {
+        return vc_gray_to_binary_global_mean(e[0], s) != 0;
+    });
+
+    // Binarização por limiares calculados do histograma (Otsu ou percentil)
+    registarTipo("limiar_otsu", 1, 1, [](const std::vector<IVC*>& e, IVC* s, const Parametros&) {
+        return vc_gray_to_binary_otsu(e[0], s) != 0;
+    });
+    registarTipo("limiar_percentil", 1, 1, [](const std::vector<IVC*>& e, IVC* s, const Parametros& p) {
+        unsigned int hist[256];
+        if (!vc_gray_histogram(e[0], hist)) return false;
+        return vc_gray_to_binary(e[0], s, vc_histogram_percentile(hist, (float)parametro(p, "percentil", 50))) != 0;
+    });
+
+    // Morfologia binária
+    registarTipo("dilatar", 1, 1, [](const std::vector<IVC*>& e, IVC* s, const Parametros& p) {
+        return vc::binary_dilate(e[0], s, parametro(p, "tamanho", 3)) != 0;
+    });
+    registarTipo("erodir", 1, 1, [](const std::vector<IVC*>& e, IVC* s, const Parametros& p) {
+        return vc::binary_erode(e[0], s, parametro(p, "tamanho", 3)) != 0;
+    });
+
+    // Fecho e abertura numa só passagem
+    registarTipo("fechar", 1, 1, [](const std::vector<IVC*>& e, IVC* s, const Parametros& p) {
+        return vc_binary_close(e[0], s, parametro(p, "tamanho", 3)) != 0;
+    });
+    registarTipo("abrir", 1, 1, [](const std::vector<IVC*>& e, IVC* s, const Parametros& p) {
+        return vc_binary_open(e[0], s, parametro(p, "tamanho", 3)) != 0;
+    });
+
+    // Preenchimento dos buracos das regiões
+    registarTipo("preencher", 1, 1, [](const std::vector<IVC*>& e, IVC* s, const Parametros&) {
+        return vc_binary_fill_holes(e[0], s) != 0;
+    });
+
+    // Combinação de duas imagens binárias (por exemplo, dois limiares calculados em paralelo)
+    registarTipo("e", 2, 1, [](const std::vector<IVC*>& e, IVC* s, const Parametros&) {
+        if (e[0]->channels != 1 || e[1]->channels != 1) return false;
+        for (int y = 0; y < s->height; y++) {
+            const unsigned char* a = &e[0]->data[y * e[0]->bytesperline];
+            const unsigned char* b = &e[1]->data[y * e[1]->bytesperline];
+            unsigned char* d = &s->data[y * s->bytesperline];
+            for (int x = 0; x < s->width; x++) d[x] = a[x] & b[x];
+        }
+        return true;
+    });
+    registarTipo("ou", 2, 1, [](const std::vector<IVC*>& e, IVC* s, const Parametros&) {
+        if (e[0]->channels != 1 || e[1]->channels != 1) return false;
+        for (int y = 0; y < s->height; y++) {
+            const unsigned char* a = &e[0]->data[y * e[0]->bytesperline];
+            const unsigned char* b = &e[1]->data[y * e[1]->bytesperline];
+            unsigned char* d = &s->data[y * s->bytesperline];
+            for (int x = 0; x < s->width; x++) d[x] = a[x] | b[x];
+        }
+        return true;
+    });
+}
+
+// Função para interpretar uma linha: [saida =] tipo(entrada, ...) [nome=valor ...]
+bool GrafoProcessamento::acrescentar(const std::string& texto, int numLinha) {
+    Etapa etapa;
+    std::string linha = texto;
+
+    size_t igual = linha.find('=');
+    size_t abre = linha.find('(');
+    size_t fecha = linha.find(')');
+    if (abre == std::string::npos || fecha == std::string::npos || fecha < abre) {
+        vc_log(VC_LOG_ERRO, "Grafo, linha %d: esperado 'tipo(entradas)'.\n", numLinha);
+        return false;
+    }
+    if (igual != std::string::npos && igual < abre) {
+        etapa.saida = aparar(linha.substr(0, igual));
+        linha = linha.substr(igual + 1);
+        abre = linha.find('(');
+        fecha = linha.find(')');
+    }
+
+    etapa.tipo = aparar(linha.substr(0, abre));
+    std::map<std::string, Tipo>::const_iterator tipo = tipos.find(etapa.tipo);
+    if (tipo == tipos.end()) {
+        vc_log(VC_LOG_ERRO, "Grafo, linha %d: tipo de etapa desconhecido '%s'.\n", numLinha, etapa.tipo.c_str());
+        return false;
+    }
+    etapa.definicao = &tipo->second;
+
+    if (etapa.definicao->canaisSaida > 0) {
+        if (etapa.saida.empty() || etapa.saida == "entrada") {
+            vc_log(VC_LOG_ERRO, "Grafo, linha %d: a etapa '%s' precisa de um nome de saída.\n", numLinha, etapa.tipo.c_str());
+            return false;
+        }
+        for (const Etapa& outra : etapas) {
+            if (outra.saida == etapa.saida) {
+                vc_log(VC_LOG_ERRO, "Grafo, linha %d: a imagem '%s' já foi declarada.\n", numLinha, etapa.saida.c_str());
+                return false;
+            }
+        }
+    } else if (!etapa.saida.empty()) {
+        vc_log(VC_LOG_ERRO, "Grafo, linha %d: a etapa final '%s' não produz imagem.\n", numLinha, etapa.tipo.c_str());
+        return false;
+    }
+
+    // Entradas: "entrada" ou uma imagem declarada numa linha anterior
+    std::string lista = linha.substr(abre + 1, fecha - abre - 1);
+    size_t pos = 0;
+    while (!aparar(lista).empty() && pos <= lista.size()) {
+        size_t virgula = lista.find(',', pos);
+        if (virgula == std::string::npos) virgula = lista.size();
+        std::string nome = aparar(lista.substr(pos, virgula - pos));
+        pos = virgula + 1;
+
+        int produtora = -2;
+        if (nome == "entrada") produtora = -1;
+        for (int i = 0; i < (int)etapas.size(); i++) {
+            if (!etapas[i].saida.empty() && etapas[i].saida == nome) produtora = i;
+        }
+        if (produtora == -2) {
+            vc_log(VC_LOG_ERRO, "Grafo, linha %d: a imagem '%s' não foi declarada antes.\n", numLinha, nome.c_str());
+            return false;
+        }
+        etapa.entradas.push_back(produtora);
+    }
+    if ((int)etapa.entradas.size() != etapa.definicao->numEntradas) {
+        vc_log(VC_LOG_ERRO, "Grafo, linha %d: '%s' tem %d entradas (esperadas %d).\n", numLinha, etapa.tipo.c_str(),
+               (int)etapa.entradas.size(), etapa.definicao->numEntradas);
+        return false;
+    }
+
+    // Parâmetros inteiros nome=valor
+    std::string resto = linha.substr(fecha + 1);
+    pos = 0;
+    while (true) {
+        size_t a = resto.find_first_not_of(" \t\r", pos);
+        if (a == std::string::npos) break;
+        size_t b = resto.find_first_of(" \t\r", a);
+        if (b == std::string::npos) b = resto.size();
+        std::string par = resto.substr(a, b - a);
+        pos = b;
+
+        size_t i = par.find('=');
+        char* fim = NULL;
+        long valor = (i == std::string::npos) ? 0 : strtol(par.c_str() + i + 1, &fim, 10);
+        if (i == std::string::npos || i == 0 || fim == par.c_str() + i + 1 || *fim != '\0') {
+            vc_log(VC_LOG_ERRO, "Grafo, linha %d: parâmetro inválido '%s' (nome=inteiro).\n", numLinha, par.c_str());
+            return false;
+        }
+        etapa.parametros[par.substr(0, i)] = (int)valor;
+    }
+
+    etapas.push_back(etapa);
+    return true;
+}
+
+bool GrafoProcessamento::carregar(const std::string& descricao) {
+    etapas.clear();
+    porNivel.clear();
+    canaisBuffer.clear();
+    libertarBuffers();
+
+    size_t inicio = 0;
+    int numLinha = 0;
+    while (inicio <= descricao.size()) {
+        size_t fim = descricao.find('\n', inicio);
+        if (fim == std::string::npos) fim = descricao.size();
+        std::string linha = descricao.substr(inicio, fim - inicio);
+        inicio = fim + 1;
+        numLinha++;
+
+        size_t comentario = linha.find('#');
+        if (comentario != std::string::npos) linha.erase(comentario);
+        if (aparar(linha).empty()) continue;
+
+        if (!acrescentar(linha, numLinha)) {
+            etapas.clear();
+            return false;
+        }
+    }
+
+    if (etapas.empty()) {
+        vc_log(VC_LOG_ERRO, "Grafo vazio!\n");
+        return false;
+    }
+
+    return planear();
+}
+
+// Função para planear a execução: níveis (ASAP) e atribuição dos buffers físicos
+bool GrafoProcessamento::planear() {
+    int n = (int)etapas.size();
+
+    // Nível de cada etapa: um a mais do que o da produtora mais tardia das suas entradas
+    int numNiveis = 0;
+    for (Etapa& etapa : etapas) {
+        etapa.nivel = 0;
+        for (int e : etapa.entradas) {
+            if (e >= 0 && etapas[e].nivel + 1 > etapa.nivel) etapa.nivel = etapas[e].nivel + 1;
+        }
+        if (etapa.nivel + 1 > numNiveis) numNiveis = etapa.nivel + 1;
+    }
+    porNivel.assign(numNiveis, std::vector<int>());
+    for (int i = 0; i < n; i++) porNivel[etapas[i].nivel].push_back(i);
+
+    // Vida de cada imagem: do nível em que é produzida ao nível da sua última leitura
+    std::vector<int> ultimoNivel(n);
+    for (int i = 0; i < n; i++) ultimoNivel[i] = etapas[i].nivel;
+    for (const Etapa& etapa : etapas) {
+        for (int e : etapa.entradas) {
+            if (e >= 0 && etapa.nivel > ultimoNivel[e]) ultimoNivel[e] = etapa.nivel;
+        }
+    }
+
+    // Um buffer fica livre no nível seguinte ao da última leitura da imagem que contém.
+    // As etapas de um nível correm em paralelo: nenhuma escreve num buffer lido no mesmo nível.
+    std::vector<int> livreDepois;
+    canaisBuffer.clear();
+    for (int nivel = 0; nivel < numNiveis; nivel++) {
+        for (int i : porNivel[nivel]) {
+            Etapa& etapa = etapas[i];
+            etapa.buffer = -1;
+            if (etapa.definicao->canaisSaida == 0) continue;
+
+            for (int b = 0; b < (int)canaisBuffer.size() && etapa.buffer < 0; b++) {
+                if (livreDepois[b] < nivel && canaisBuffer[b] == etapa.definicao->canaisSaida) etapa.buffer = b;
+            }
+            if (etapa.buffer < 0) {
+                etapa.buffer = (int)canaisBuffer.size();
+                canaisBuffer.push_back(etapa.definicao->canaisSaida);
+                livreDepois.push_back(0);
+            }
+            livreDepois[etapa.buffer] = ultimoNivel[i];
+        }
+    }
+
+    return true;
+}
+
+void GrafoProcessamento::descrever() const {
+    int imagens = 0;
+    for (const Etapa& etapa : etapas) {
+        std::string entradas;
+        for (int e : etapa.entradas) {
+            if (!entradas.empty()) entradas += ", ";
+            entradas += (e < 0) ? std::string("entrada") : etapas[e].saida;
+        }
+        if (etapa.buffer >= 0) {
+            imagens++;
+            vc_log(VC_LOG_INFO, "  nível %d: %s = %s(%s) -> buffer %d\n", etapa.nivel, etapa.saida.c_str(),
+                   etapa.tipo.c_str(), entradas.c_str(), etapa.buffer);
+        } else {
+            vc_log(VC_LOG_INFO, "  nível %d: %s(%s)\n", etapa.nivel, etapa.tipo.c_str(), entradas.c_str());
+        }
+    }
+    vc_log(VC_LOG_INFO, "Grafo: %d etapas em %d níveis, %d imagens intermédias em %d buffers.\n",
+           numEtapas(), numNiveis(), imagens, numBuffers());
+}
+
+void GrafoProcessamento::libertarBuffers() {
+    for (IVC* buffer : buffers) vc_image_free(buffer);
+    buffers.clear();
+}
+
+bool GrafoProcessamento::executarEtapa(int i, IVC* entrada) {
+    const Etapa& etapa = etapas[i];
+
+    std::vector<IVC*> entradas;
+    entradas.reserve(etapa.entradas.size());
+    for (int e : etapa.entradas) entradas.push_back(e < 0 ? entrada : buffers[etapas[e].buffer]);
+    IVC* saida = etapa.buffer >= 0 ? buffers[etapa.buffer] : NULL;
+
+    if (!etapa.definicao->funcao(entradas, saida, etapa.parametros)) {
+        vc_log_limited(VC_LOG_ERRO, 1, "Grafo: a etapa '%s' falhou!\n", etapa.tipo.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool GrafoProcessamento::executar(IVC* entrada) {
+    if (entrada == NULL || porNivel.empty()) return false;
+
+    // Buffers com as dimensões do frame (realocados só se as dimensões mudarem)
+    if (!buffers.empty() && (buffers[0]->width != entrada->width || buffers[0]->height != entrada->height)) {
+        libertarBuffers();
+    }
+    if (buffers.empty()) {
+        for (int canais : canaisBuffer) {
+            IVC* buffer = vc_image_new(entrada->width, entrada->height, canais, 255);
+            if (buffer == NULL) {
+                vc_log(VC_LOG_ERRO, "Grafo: erro ao alocar memória para os buffers!\n");
+                libertarBuffers();
+                return false;
+            }
+            buffers.push_back(buffer);
+        }
+    }
+
+    // Nível a nível; as etapas independentes de um nível correm em paralelo
+    bool ok = true;
+    for (const std::vector<int>& nivel : porNivel) {
+        if (nivel.size() == 1) {
+            ok = executarEtapa(nivel[0], entrada);
+            if (!ok) break;
+            continue;
+        }
+
+        // A primeira etapa corre nesta thread; as restantes vão para os trabalhadores
+        while (trabalhadores.size() < nivel.size() - 1) trabalhadores.emplace_back(&GrafoProcessamento::trabalhar, this);
+
+        std::vector<char> resultados(nivel.size(), 0);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            entradaAtual = entrada;
+            for (size_t k = 1; k < nivel.size(); k++) pedidos.push_back({ nivel[k], &resultados[k] });
+            pendentes = (int)nivel.size() - 1;
+        }
+        condicao.notify_all();
+
+        resultados[0] = executarEtapa(nivel[0], entrada);
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            concluido.wait(lock, [this] { return pendentes == 0; });
+        }
+
+        for (char r : resultados) ok = ok && r;
+        if (!ok) break;
+    }
+
+    return ok;
+}
@@ -0,0 +1,109 @@
+#ifndef GRAFO_H
+#define GRAFO_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+extern "C" {
+#include "vc.h"
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//             GRAFO DE PROCESSAMENTO (DECLARATIVO)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// As etapas são declaradas com as suas entradas e saída, uma por linha:
+//
+//     cinza = cinzento(entrada)
+//     suave = gaussiano(cinza) raio=2
+//     detetar(entrada, suave) area=300        (etapa final: não produz imagem)
+//
+// "entrada" é a imagem do frame. Cada entrada tem de ter sido declarada numa linha anterior,
+// pelo que a ordem das linhas é uma ordem topológica e as etapas podem ser trocadas ou
+// reordenadas sem recompilar. O plano agrupa as etapas em níveis (as de um mesmo nível são
+// independentes e correm em paralelo) e atribui as imagens intermédias a buffers físicos
+// pela análise de vida: um buffer é reutilizado logo que a sua última leitura termina.
+// As etapas paralelas correm em trabalhadores persistentes (criados uma vez, não em cada frame).
+class GrafoProcessamento {
+public:
+    typedef std::map<std::string, int> Parametros;
+
+    // Função de uma etapa: imagens de entrada, imagem de saída (NULL nas etapas finais) e parâmetros
+    typedef std::function<bool(const std::vector<IVC*>& entradas, IVC* saida, const Parametros& parametros)> Funcao;
+
+    GrafoProcessamento();
+    ~GrafoProcessamento();
+
+    GrafoProcessamento(const GrafoProcessamento&) = delete;
+    GrafoProcessamento& operator=(const GrafoProcessamento&) = delete;
+
+    // Regista um tipo de etapa; canaisSaida = 0 para etapas finais (sem imagem de saída)
+    void registarTipo(const std::string& tipo, int numEntradas, int canaisSaida, Funcao funcao);
+
+    // Lê a descrição do grafo (texto com uma etapa por linha) e planeia a execução
+    bool carregar(const std::string& descricao);
+
+    // Executa todas as etapas sobre a imagem do frame
+    bool executar(IVC* entrada);
+
+    int numEtapas() const { return (int)etapas.size(); }
+    int numNiveis() const { return (int)porNivel.size(); }
+    int numBuffers() const { return (int)canaisBuffer.size(); }
+
+    // Escreve o plano no registo (níveis e buffer de cada etapa)
+    void descrever() const;
+
+    static int parametro(const Parametros& parametros, const char* nome, int omissao);
+
+private:
+    struct Tipo {
+        int numEntradas;
+        int canaisSaida;
+        Funcao funcao;
+    };
+
+    struct Etapa {
+        std::string saida;              // Nome da imagem produzida (vazio nas etapas finais)
+        std::string tipo;
+        std::vector<int> entradas;      // Índice da etapa produtora (-1 = entrada)
+        Parametros parametros;
+        int nivel = 0;
+        int buffer = -1;                // Buffer físico da saída
+        const Tipo* definicao = NULL;
+    };
+
+    struct Pedido {
+        int etapa;
+        char* resultado;                // Onde o trabalhador escreve o sucesso da etapa
+    };
+
+    bool acrescentar(const std::string& linha, int numLinha);
+    bool planear();
+    bool executarEtapa(int i, IVC* entrada);
+    void registarTiposBase();
+    void libertarBuffers();
+    void trabalhar();
+
+    std::map<std::string, Tipo> tipos;
+    std::vector<Etapa> etapas;
+    std::vector<std::vector<int>> porNivel;   // Etapas de cada nível, pela ordem de declaração
+    std::vector<int> canaisBuffer;      // Canais de cada buffer físico
+    std::vector<IVC*> buffers;          // Alocados no primeiro frame (e se as dimensões mudarem)
+
+    // Trabalhadores das etapas paralelas (tantos quantos o maior nível precisa, menos um)
+    std::vector<std::thread> trabalhadores;
+    std::mutex mutex;
+    std::condition_variable condicao;   // Há pedidos (ou é para terminar)
+    std::condition_variable concluido;  // Terminaram todos os pedidos do nível
+    std::deque<Pedido> pedidos;
+    IVC* entradaAtual = NULL;           // Frame do nível em curso
+    int pendentes = 0;                  // Pedidos do nível ainda por terminar
+    bool terminar = false;
+};
+
+#endif
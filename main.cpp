@@ -6,14 +6,28 @@
 #include <opencv2/core.hpp>
 #include <opencv2/highgui.hpp>
 #include <opencv2/videoio.hpp>
-#include <stack>
 #include <filesystem>
 #include <iostream>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
 
 extern "C" {
 #include "vc.h"
+#include "vc_log.h"
 }
 
+#include "vc_kernels.hpp"
+#include "depuracao.h"
+#include "fonte.h"
+#include "arquivo.h"
+#include "grafo.h"
+
 using namespace std;
 using namespace cv;
 
@@ -22,173 +36,361 @@ using namespace cv;
 #define M_PI 3.14159265358979323846
 #endif
 
-// Definição da estrutura InfoMoeda
-struct InfoMoeda {
-    int tipo;           // 1, 2, 5, 10, 20, 50 cents or 1, 2 euros
-    double valor;       // Valor monetário
-    int x, y;           // Centro da moeda
-    double area;        // Área em pixels
-    double perimetro;   // Perímetro em pixels
-    int x1, y1, x2, y2; // Caixa delimitadora
-    double circularidade; // Medida de circularidade
-};
+// Deteções de um frame em estrutura de arrays: cada característica num vetor contíguo,
+// para que classificação, filtragem e escrita percorram um campo de cada vez.
+// A capacidade só cresce; limpar() mantém a memória para o frame seguinte.
+struct Deteccoes {
+    int n = 0;
+    int capacidade = 0;
+    int rejeitadas = 0;                 // Regiões grandes rejeitadas por não serem circulares
+    std::vector<int> tipo;              // 1, 2, 5, 10, 20, 50 cents or 1, 2 euros
+    std::vector<float> valor;           // Valor monetário
+    std::vector<int> x, y;              // Centro da moeda
+    std::vector<float> area;            // Área em pixels
+    std::vector<float> perimetro;       // Perímetro em pixels
+    std::vector<int> x1, y1, x2, y2;    // Caixa delimitadora
+    std::vector<float> circularidade;   // Medida de circularidade
+    std::vector<float> excentricidade;  // Excentricidade da elipse equivalente (0 = círculo)
+    std::vector<float> orientacao;      // Orientação do eixo maior (radianos)
+    std::vector<float> diametro;        // Diâmetro equivalente em pixels
+    std::vector<float> hu;              // Momentos invariantes de Hu (7 por deteção)
+    std::vector<float> matiz;           // Matiz média (graus; média circular pesada pela saturação)
+    std::vector<float> saturacao;       // Saturação média (0..255)
+    std::vector<float> bimetal;         // Distância entre as cores médias do centro e do anel exterior
 
-// Declarações das funções
-void floodFill(IVC* imagemBinaria, int* visitado, int x, int y, int width, int height, int bytesperline);
-void calcularCaracteristicas(InfoMoeda* moeda, IVC* imagem, IVC* imagemBinaria, int* visitado);
-void classificarMoeda(InfoMoeda* moeda);
-
-// Função para calcular características da moeda
-void calcularCaracteristicas(InfoMoeda* moeda, IVC* imagem, IVC* imagemBinaria, int* visitado) {
-    int width = imagem->width;
-    int height = imagem->height;
-    int bytesperline = imagemBinaria->bytesperline;
-    
-    // Percorrer todos os pixels visitados
-    for(int y = 0; y < height; y++) {
-        for(int x = 0; x < width; x++) {
-            if(visitado[y * width + x]) {
-                // Atualizar área
-                moeda->area++;
-                
-                // Atualizar centroide
-                moeda->x += x;
-                moeda->y += y;
-                
-                // Atualizar caixa delimitadora
-                if(x < moeda->x1) moeda->x1 = x;
-                if(y < moeda->y1) moeda->y1 = y;
-                if(x > moeda->x2) moeda->x2 = x;
-                if(y > moeda->y2) moeda->y2 = y;
-            }
+    void limpar() { n = 0; rejeitadas = 0; }
+
+    // Reserva uma nova deteção e devolve o seu índice (duplica a capacidade quando esgota)
+    int acrescentar() {
+        if (n == capacidade) {
+            capacidade = (capacidade > 0) ? capacidade * 2 : 64;
+            tipo.resize(capacidade); valor.resize(capacidade);
+            x.resize(capacidade); y.resize(capacidade);
+            area.resize(capacidade); perimetro.resize(capacidade);
+            x1.resize(capacidade); y1.resize(capacidade); x2.resize(capacidade); y2.resize(capacidade);
+            circularidade.resize(capacidade); excentricidade.resize(capacidade);
+            orientacao.resize(capacidade); diametro.resize(capacidade);
+            hu.resize(capacidade * 7);
+            matiz.resize(capacidade); saturacao.resize(capacidade); bimetal.resize(capacidade);
         }
+        return n++;
     }
+
+    // Desfaz o último acrescentar() (deteção rejeitada depois de calculada)
+    void removerUltima() { if (n > 0) n--; }
+
+    // Copia a deteção i de outro conjunto, deslocada de (dx, dy)
+    int copiar(const Deteccoes& outra, int i, int dx, int dy) {
+        int k = acrescentar();
+        tipo[k] = outra.tipo[i]; valor[k] = outra.valor[i];
+        x[k] = outra.x[i] + dx; y[k] = outra.y[i] + dy;
+        area[k] = outra.area[i]; perimetro[k] = outra.perimetro[i];
+        x1[k] = outra.x1[i] + dx; y1[k] = outra.y1[i] + dy;
+        x2[k] = outra.x2[i] + dx; y2[k] = outra.y2[i] + dy;
+        circularidade[k] = outra.circularidade[i]; excentricidade[k] = outra.excentricidade[i];
+        orientacao[k] = outra.orientacao[i]; diametro[k] = outra.diametro[i];
+        memcpy(&hu[k * 7], &outra.hu[i * 7], 7 * sizeof(float));
+        matiz[k] = outra.matiz[i]; saturacao[k] = outra.saturacao[i]; bimetal[k] = outra.bimetal[i];
+        return k;
+    }
+};
+
+// Circularidade mínima de uma moeda (4 pi área / perímetro^2; duas moedas encostadas dão cerca de 0.5)
+#define CIRCULARIDADE_MINIMA 0.75f
+
+// Disco interior e início do anel exterior da cor (frações do raio equivalente)
+#define RAIO_INTERIOR 0.5f
+#define RAIO_EXTERIOR 0.8f
+
+// Recursos da deteção reutilizados entre frames
+struct ContextoDeteccao {
+    BVC* blobs = vc_blobs_new();        // Etiquetagem
+    BVC* partes = vc_blobs_new();       // Etiquetagem das partes de uma região separada
+    CVC* contorno = vc_contour_new();   // Contorno de cada região
+    Deteccoes candidatos, refinadas;    // Modo pirâmide
+    IVC* binariaReduzida = NULL;        // Modo pirâmide: imagem binária do nível reduzido (último frame)
+    std::vector<EVC> cores, coresPartes; // Estatísticas de cor das regiões e das partes
+    float separacao = 0.5f;             // Marcadores da separação (fração da distância máxima; 0 = desligada)
+
+    ContextoDeteccao() = default;
+    ContextoDeteccao(const ContextoDeteccao&) = delete;
+    ContextoDeteccao& operator=(const ContextoDeteccao&) = delete;
+    ~ContextoDeteccao() {
+        vc_blobs_free(blobs);
+        vc_blobs_free(partes);
+        vc_contour_free(contorno);
+        vc_image_free(binariaReduzida);
+    }
+};
+
+// Tabela de denominações, carregada no arranque (ver denominacoes.txt)
+// Cada tipo de moeda é descrito pelo centróide das suas características; cada característica
+// medida é multiplicada pela sua escala (calibração da câmara) antes de procurar o centróide mais
+// próximo. As características de cor têm peso 0 por omissão (tabelas só com a área não mudam).
+#define NUM_CARACTERISTICAS 4   // área, matiz, saturação, bimetal
+static const char* nomesCaracteristicas[NUM_CARACTERISTICAS] = { "area", "matiz", "saturacao", "bimetal" };
+struct TabelaMoedas {
+    std::vector<int> tipo;              // Tipo (cêntimos)
+    std::vector<float> centroides;      // NUM_CARACTERISTICAS valores por tipo
+    float escala[NUM_CARACTERISTICAS] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    float peso[NUM_CARACTERISTICAS] = { 1.0f, 0.0f, 0.0f, 0.0f };
+    std::vector<int> classes;           // Resultado do lote (reutilizado entre frames)
+};
+
+// Declarações das funções
+void calcularCaracteristicas(Deteccoes& moedas, int i, OVC* blob, IVC* imagemBinaria, CVC* contorno);
+void calcularCor(Deteccoes& moedas, int i, const EVC* cor);
+void tabelaPorOmissao(TabelaMoedas& tabela);
+bool carregarTabelaMoedas(const char* ficheiro, TabelaMoedas& tabela);
+void classificarMoedas(TabelaMoedas& tabela, Deteccoes& moedas);
+int detectarMoedas(ContextoDeteccao& ctx, IVC* imagem, IVC* imagemBinaria, Deteccoes& moedas, int areaMinima);
+int separarRegiao(ContextoDeteccao& ctx, IVC* imagem, OVC* blob, Deteccoes& moedas, int areaMinima);
+void segmentarImagem(IVC* imagemOriginal, IVC* imagemBinaria, int fator);
+int detectarMoedasPiramide(ContextoDeteccao& ctx, IVC* imagem, int fator, Deteccoes& moedas);
+
+// Função para calcular características da moeda i a partir do blob etiquetado
+// (área, caixa, centroide e momentos já vêm da etiquetagem; só o contorno é percorrido)
+void calcularCaracteristicas(Deteccoes& moedas, int i, OVC* blob, IVC* imagemBinaria, CVC* contorno) {
+    moedas.area[i] = (float)blob->area;
+    moedas.x[i] = blob->xc;
+    moedas.y[i] = blob->yc;
+    moedas.x1[i] = blob->x;
+    moedas.y1[i] = blob->y;
+    moedas.x2[i] = blob->x + blob->width - 1;
+    moedas.y2[i] = blob->y + blob->height - 1;
+    moedas.excentricidade[i] = (float)blob->eccentricity;
+    moedas.orientacao[i] = (float)blob->orientation;
+    moedas.diametro[i] = (float)blob->diameter;
+    for (int k = 0; k < 7; k++) moedas.hu[i * 7 + k] = (float)blob->hu[k];
     
-    // Calcular centroide
-    moeda->x /= moeda->area;
-    moeda->y /= moeda->area;
-    
-    // Calcular perímetro (aproximado)
-    moeda->perimetro = 2 * (moeda->x2 - moeda->x1 + moeda->y2 - moeda->y1);
+    // Calcular perímetro real, seguindo apenas os pixels da fronteira
+    vc_binary_contour_trace(imagemBinaria, blob->xstart, blob->ystart, contorno);
+    moedas.perimetro[i] = (float)contorno->perimeter;
     
     // Calcular circularidade
-    double area = moeda->area;
-    double perimetro = moeda->perimetro;
-    moeda->circularidade = (4 * M_PI * area) / (perimetro * perimetro);
+    double area = blob->area;
+    double perimetro = contorno->perimeter;
+    moedas.circularidade[i] = (perimetro > 0) ? (float)((4 * M_PI * area) / (perimetro * perimetro)) : 0.0f;
 }
 
-// Função para classificar moeda com base na área
-void classificarMoeda(InfoMoeda* moeda) {
-    // Valores aproximados de área para cada tipo de moeda
-    // Estes valores precisarão ser ajustados com base nos dados reais
-    if(moeda->area < 2000) {
-        moeda->tipo = 1; // 1 cent
-        moeda->valor = 0.01;
-    } else if(moeda->area < 3000) {
-        moeda->tipo = 2; // 2 cents
-        moeda->valor = 0.02;
-    } else if(moeda->area < 4000) {
-        moeda->tipo = 5; // 5 cents
-        moeda->valor = 0.05;
-    } else if(moeda->area < 5000) {
-        moeda->tipo = 10; // 10 cents
-        moeda->valor = 0.10;
-    } else if(moeda->area < 6000) {
-        moeda->tipo = 20; // 20 cents
-        moeda->valor = 0.20;
-    } else if(moeda->area < 7000) {
-        moeda->tipo = 50; // 50 cents
-        moeda->valor = 0.50;
-    } else if(moeda->area < 8000) {
-        moeda->tipo = 100; // 1 euro
-        moeda->valor = 1.0;
-    } else {
-        moeda->tipo = 200; // 2 euros
-        moeda->valor = 2.0;
+// Função para passar as estatísticas de cor do blob para a moeda i (NULL = sem cor, ex.: modo luma)
+void calcularCor(Deteccoes& moedas, int i, const EVC* cor) {
+    moedas.matiz[i] = 0.0f;
+    moedas.saturacao[i] = 0.0f;
+    moedas.bimetal[i] = 0.0f;
+    if (cor == NULL || cor->area == 0) return;
+
+    moedas.matiz[i] = cor->hsv_mean[0];
+    moedas.saturacao[i] = cor->hsv_mean[1];
+
+    // Moedas de 1 e 2 euros: centro e anel de metais diferentes
+    if (cor->inner_n > 0 && cor->outer_n > 0) {
+        float d2 = 0.0f;
+        for (int c = 0; c < 3; c++) {
+            float d = cor->inner_mean[c] - cor->outer_mean[c];
+            d2 += d * d;
+        }
+        moedas.bimetal[i] = sqrtf(d2);
     }
 }
 
-// Substituir a função floodFill existente por esta versão iterativa
-void floodFill(IVC* imagemBinaria, int* visitado, int x, int y, int width, int height, int bytesperline) {
-    std::stack<std::pair<int, int>> pilha;
-    pilha.push({x, y});
+// Função para preencher a tabela com os valores por omissão
+// (centróides a meio dos intervalos de área originais: < 2000 = 1 cent, ..., >= 8000 = 2 euros)
+void tabelaPorOmissao(TabelaMoedas& tabela) {
+    const int tipos[] = { 1, 2, 5, 10, 20, 50, 100, 200 };
 
-    while (!pilha.empty()) {
-        auto [cx, cy] = pilha.top();
-        pilha.pop();
+    tabela.tipo.clear();
+    tabela.centroides.clear();
+    for (int i = 0; i < 8; i++) {
+        tabela.tipo.push_back(tipos[i]);
+        tabela.centroides.push_back(1500.0f + 1000.0f * i);
+        for (int c = 1; c < NUM_CARACTERISTICAS; c++) tabela.centroides.push_back(0.0f);
+    }
+}
 
-        int pos = cy * bytesperline + cx;
-        if (cx < 0 || cx >= width || cy < 0 || cy >= height || imagemBinaria->data[pos] != 255 || visitado[cy * width + cx]) {
-            continue;
+// Função para carregar a tabela de denominações; sem ficheiro (ou sem nenhuma linha de tipo válida),
+// usa os valores por omissão e devolve false
+// Formato: linhas "tipo area [matiz saturacao bimetal]" (as colunas em falta valem 0),
+// "escala <caracteristica> <fator>" e "peso <caracteristica> <peso>"; '#' inicia um comentário
+bool carregarTabelaMoedas(const char* ficheiro, TabelaMoedas& tabela) {
+    FILE* file = fopen(ficheiro, "r");
+    char linha[256];
+    int numLinha = 0;
+
+    tabela.tipo.clear();
+    tabela.centroides.clear();
+
+    if (file == NULL) {
+        tabelaPorOmissao(tabela);
+        vc_log(VC_LOG_AVISO, "Tabela '%s' não encontrada: a usar valores por omissão.\n", ficheiro);
+        return false;
+    }
+
+    while (fgets(linha, sizeof(linha), file) != NULL) {
+        int tipo;
+        float valor;
+        float valores[NUM_CARACTERISTICAS] = { 0.0f };
+        char nome[32];
+        numLinha++;
+
+        char* comentario = strchr(linha, '#');
+        if (comentario != NULL) *comentario = '\0';
+
+        bool escala = sscanf(linha, " escala %31s %f", nome, &valor) == 2;
+        bool peso = !escala && sscanf(linha, " peso %31s %f", nome, &valor) == 2;
+        if (escala || peso) {
+            int c = 0;
+            while (c < NUM_CARACTERISTICAS && strcmp(nome, nomesCaracteristicas[c]) != 0) c++;
+            if (c == NUM_CARACTERISTICAS) {
+                vc_log(VC_LOG_AVISO, "Linha %d de '%s': característica '%s' desconhecida.\n", numLinha, ficheiro, nome);
+            } else if (escala) {
+                tabela.escala[c] = valor;
+            } else {
+                tabela.peso[c] = valor;
+            }
+        } else if (sscanf(linha, " %d %f %f %f %f", &tipo, &valores[0], &valores[1], &valores[2], &valores[3]) >= 2) {
+            tabela.tipo.push_back(tipo);
+            tabela.centroides.insert(tabela.centroides.end(), valores, valores + NUM_CARACTERISTICAS);
+        } else {
+            char vazio[2];
+            if (sscanf(linha, " %1s", vazio) == 1) {
+                vc_log(VC_LOG_AVISO, "Linha %d de '%s' ignorada.\n", numLinha, ficheiro);
+            }
         }
+    }
 
-        visitado[cy * width + cx] = 1;
+    fclose(file);
 
-        // Adicionar vizinhos à pilha (4-conectividade)
-        pilha.push({cx + 1, cy});
-        pilha.push({cx - 1, cy});
-        pilha.push({cx, cy + 1});
-        pilha.push({cx, cy - 1});
+    // Sem tipos, todas as moedas ficariam por classificar
+    if (tabela.tipo.empty()) {
+        tabelaPorOmissao(tabela);
+        vc_log(VC_LOG_ERRO, "Tabela '%s' sem tipos de moeda válidos: a usar valores por omissão.\n", ficheiro);
+        return false;
+    }
+
+    vc_log(VC_LOG_INFO, "Tabela '%s': %d tipos de moeda.\n", ficheiro, (int)tabela.tipo.size());
+
+    return true;
+}
+
+// Função para classificar todas as moedas do frame num só lote (centróide mais próximo)
+void classificarMoedas(TabelaMoedas& tabela, Deteccoes& moedas) {
+    int numTipos = (int)tabela.tipo.size();
+    if (moedas.n == 0 || numTipos == 0) return;
+
+    if ((int)tabela.classes.size() < moedas.capacidade) tabela.classes.resize(moedas.capacidade);
+
+    const float* caracteristicas[NUM_CARACTERISTICAS] = {
+        moedas.area.data(), moedas.matiz.data(), moedas.saturacao.data(), moedas.bimetal.data()
+    };
+    vc_classify_nearest_centroid(caracteristicas, NUM_CARACTERISTICAS, moedas.n, tabela.escala, tabela.peso,
+                                 tabela.centroides.data(), numTipos, tabela.classes.data());
+
+    for (int i = 0; i < moedas.n; i++) {
+        moedas.tipo[i] = tabela.tipo[tabela.classes[i]];
+        moedas.valor[i] = moedas.tipo[i] / 100.0f;
     }
 }
 
-// Função para processar a imagem binária e detectar moedas
-int detectarMoedas(IVC* imagem, IVC* imagemBinaria, InfoMoeda* moedas, int maxMoedas) {
+// Função para processar a imagem binária e detectar moedas (acrescenta-as a moedas)
+int detectarMoedas(ContextoDeteccao& ctx, IVC* imagem, IVC* imagemBinaria, Deteccoes& moedas, int areaMinima) {
     int numMoedas = 0;
-    int width = imagem->width;
-    int height = imagem->height;
-    int bytesperline = imagemBinaria->bytesperline;
-    unsigned char* dataBin = imagemBinaria->data;
-    
-    // Matriz para marcar pixels já processados
-    int* visitado = (int*)malloc(width * height * sizeof(int));
-    memset(visitado, 0, width * height * sizeof(int));
-    
-    // Lista para armazenar pixels do contorno
-    int* contornoX = (int*)malloc(10000 * sizeof(int));
-    int* contornoY = (int*)malloc(10000 * sizeof(int));
-    int contornoSize = 0;
-    
-    for(int y = 0; y < height && numMoedas < maxMoedas; y++) {
-        for(int x = 0; x < width && numMoedas < maxMoedas; x++) {
-            int pos = y * bytesperline + x;
-            
-            // Se encontrarmos um pixel branco não visitado
-            if(dataBin[pos] == 255 && !visitado[y * width + x]) {
-                // Inicializar moeda
-                InfoMoeda* moeda = &moedas[numMoedas];
-                moeda->area = 0;
-                moeda->perimetro = 0;
-                moeda->x = 0;
-                moeda->y = 0;
-                moeda->x1 = width;
-                moeda->y1 = height;
-                moeda->x2 = 0;
-                moeda->y2 = 0;
-                
-                // Fazer flood fill para encontrar toda a região
-                floodFill(imagemBinaria, visitado, x, y, width, height, bytesperline);
-                
-                // Calcular características da moeda
-                calcularCaracteristicas(moeda, imagem, imagemBinaria, visitado);
-                
-                // Verificar se é uma moeda válida (baseado em área e circularidade)
-                if (moeda->area > 300 && moeda->circularidade > 0.75) {
-                    classificarMoeda(moeda);
-                    numMoedas++;
-                }
-            }
+    
+    // Etiquetar todas as regiões numa só passagem (área, caixa e momentos por etiqueta)
+    int numBlobs = vc_binary_blob_labelling(imagemBinaria, ctx.blobs);
+    
+    // Cor das regiões aceites, percorrendo só as suas sequências (o modo luma não tem cor)
+    const EVC* cores = NULL;
+    if (imagem->channels == 3 && numBlobs > 0) {
+        ctx.cores.resize(numBlobs);
+        if (vc_blobs_color_stats(imagem, ctx.blobs, 0, 0, areaMinima, RAIO_INTERIOR, RAIO_EXTERIOR, ctx.cores.data())) {
+            cores = ctx.cores.data();
         }
     }
     
-    // Limpar memória
-    free(visitado);
-    free(contornoX);
-    free(contornoY);
+    for (int i = 0; i < numBlobs; i++) {
+        OVC* blob = &ctx.blobs->blobs[i];
+        
+        // Regiões pequenas são rejeitadas sem percorrer o contorno
+        if (blob->area <= areaMinima) continue;
+        
+        int k = moedas.acrescentar();
+        calcularCaracteristicas(moedas, k, blob, imagemBinaria, ctx.contorno);
+        calcularCor(moedas, k, (cores != NULL) ? &cores[i] : NULL);
+        
+        // Verificar se é uma moeda válida (baseado em área e circularidade)
+        // A classificação é feita depois, em lote, por classificarMoedas()
+        if (moedas.circularidade[k] > CIRCULARIDADE_MINIMA) {
+            numMoedas++;
+        } else {
+            // Moedas encostadas formam uma só região: separá-las dentro da caixa da região
+            moedas.removerUltima();
+            int partes = (ctx.separacao > 0.0f) ? separarRegiao(ctx, imagem, blob, moedas, areaMinima) : 0;
+            if (partes > 0) numMoedas += partes;
+            else moedas.rejeitadas++;
+        }
+    }
     
     return numMoedas;
 }
 
+// Função para separar uma região não circular (moedas que se tocam) por watershed, só na sua caixa;
+// acrescenta as partes circulares às moedas e devolve quantas foram acrescentadas
+int separarRegiao(ContextoDeteccao& ctx, IVC* imagem, OVC* blob, Deteccoes& moedas, int areaMinima) {
+    // Recorte com uma margem preta de 1 pixel, só com os píxeis desta região (a caixa pode conter outras)
+    int x0 = blob->x - 1, y0 = blob->y - 1;
+    IVC* recorte = vc_image_new(blob->width + 2, blob->height + 2, 1, 255);
+    if (recorte == NULL) return 0;
+    memset(recorte->data, 0, recorte->bytesperline * recorte->height);
+
+    // As sequências estão por ordem raster: só são percorridas as das linhas da caixa (pesquisa binária)
+    const RVC* runs = ctx.blobs->runs;
+    const RVC* inicio = std::lower_bound(runs, runs + ctx.blobs->nruns, blob->y,
+                                         [](const RVC& run, int y) { return run.y < y; });
+    for (const RVC* r = inicio; r < runs + ctx.blobs->nruns && r->y < blob->y + blob->height; r++) {
+        const RVC& run = *r;
+        if (run.label == blob->label) {
+            memset(&recorte->data[(run.y - y0) * recorte->bytesperline + run.x1 - x0], 255, run.x2 - run.x1 + 1);
+        }
+    }
+
+    int numPartes = 0;
+    if (vc_binary_watershed_split(recorte, ctx.separacao) >= 2) {
+        int n = vc_binary_blob_labelling(recorte, ctx.partes);
+
+        // Cor das partes: as sequências do recorte deslocadas para a imagem
+        const EVC* cores = NULL;
+        if (imagem->channels == 3 && n > 0) {
+            ctx.coresPartes.resize(n);
+            if (vc_blobs_color_stats(imagem, ctx.partes, x0, y0, areaMinima, RAIO_INTERIOR, RAIO_EXTERIOR, ctx.coresPartes.data())) {
+                cores = ctx.coresPartes.data();
+            }
+        }
+
+        for (int j = 0; j < n; j++) {
+            OVC* parte = &ctx.partes->blobs[j];
+            if (parte->area <= areaMinima) continue;
+
+            int k = moedas.acrescentar();
+            calcularCaracteristicas(moedas, k, parte, recorte, ctx.contorno);
+            calcularCor(moedas, k, (cores != NULL) ? &cores[j] : NULL);
+            if (moedas.circularidade[k] <= CIRCULARIDADE_MINIMA) {
+                moedas.removerUltima();
+                continue;
+            }
+
+            // Passar para coordenadas da imagem
+            moedas.x[k] += x0; moedas.y[k] += y0;
+            moedas.x1[k] += x0; moedas.y1[k] += y0;
+            moedas.x2[k] += x0; moedas.y2[k] += y0;
+            numPartes++;
+        }
+    }
+
+    vc_image_free(recorte);
+    return numPartes;
+}
+
 // Função para segmentar a imagem e isolar as moedas
 /* void segmentarImagem(IVC* imagemOriginal, IVC* imagemBinaria) {
     // Converter para escala de cinza
@@ -223,194 +425,515 @@ int detectarMoedas(IVC* imagem, IVC* imagemBinaria, InfoMoeda* moedas, int maxMo
     vc_image_free(imagemGray);
     vc_image_free(imagemFiltrada);
 } */
-void segmentarImagem(IVC* imagemOriginal, IVC* imagemBinaria) {
-    // Converter para escala de cinza
-    IVC* imagemGray = vc_image_new(imagemOriginal->width, imagemOriginal->height, 1, 255);
-    vc_rgb_to_gray(imagemOriginal, imagemGray);
-
-    // Aplicar filtro Gaussiano para reduzir ruído
-    IVC* imagemFiltrada = vc_image_new(imagemOriginal->width, imagemOriginal->height, 1, 255);
-
-    int kernelSize = 5; // Tamanho do kernel Gaussiano (ajustável)
-    float sigma = 1.0;  // Desvio padrão (ajustável)
-
-    // Gerar kernel Gaussiano 1D
-    float kernel[kernelSize];
-    float sum = 0.0;
-    int half = kernelSize / 2;
-    for (int i = 0; i < kernelSize; i++) {
-        int x = i - half;
-        kernel[i] = exp(-(x * x) / (2 * sigma * sigma));
-        sum += kernel[i];
-    }
-    // Normalizar kernel
-    for (int i = 0; i < kernelSize; i++) {
-        kernel[i] /= sum;
-    }
-
-    // Aplicar filtro Gaussiano (primeiro horizontalmente)
-    for (int y = 0; y < imagemGray->height; y++) {
-        for (int x = 0; x < imagemGray->width; x++) {
-            float value = 0.0;
-            for (int k = -half; k <= half; k++) {
-                int xi = x + k;
-                if (xi >= 0 && xi < imagemGray->width) {
-                    value += imagemGray->data[y * imagemGray->bytesperline + xi] * kernel[k + half];
-                }
-            }
-            imagemFiltrada->data[y * imagemGray->bytesperline + x] = (unsigned char) value;
-        }
+// O fator indica a redução de resolução da imagem (1 = resolução original)
+void segmentarImagem(IVC* imagemOriginal, IVC* imagemBinaria, int fator) {
+    // Converter para escala de cinza (uma imagem com 1 canal, como o plano Y do modo luma, já é cinzenta)
+    IVC* imagemGray = imagemOriginal;
+    if (imagemOriginal->channels != 1) {
+        imagemGray = vc_image_new(imagemOriginal->width, imagemOriginal->height, 1, 255);
+        vc_rgb_to_gray(imagemOriginal, imagemGray);
     }
 
-    // Suavizar a imagem para reduzir o ruído
-    vc_gray_gaussian_blur(imagemGray, imagemFiltrada);
+    // Suavizar a imagem para reduzir o ruído (5x5, kernel especializado em tempo de compilação)
+    // A margem é replicada: a binarização adaptativa também lê os 2 pixels da borda
+    IVC* imagemFiltrada = vc_image_new(imagemOriginal->width, imagemOriginal->height, 1, 255);
+    vc::gaussian_blur(imagemGray, imagemFiltrada, 2, vc::Borda::Replicar);
 
     // Binarizar adaptativamente (considera variações locais de iluminação)
-    vc_gray_to_binary_adaptive_mean(imagemFiltrada, imagemBinaria, 15, 20);
+    // A janela acompanha a escala da imagem; a margem que a janela não cobre fica a preto
+    int janela = (15 / fator) | 1;
+    if (janela < 3) janela = 3;
+    memset(imagemBinaria->data, 0, imagemBinaria->bytesperline * imagemBinaria->height);
+    vc::gray_to_binary_adaptive_mean(imagemFiltrada, imagemBinaria, janela, 20);
 
-    // Melhorar detecção: operações morfológicas
-    vc_binary_dilate(imagemBinaria, imagemBinaria, 3);
-    vc_binary_erode(imagemBinaria, imagemBinaria, 3);
+    // Melhorar detecção: fecho morfológico (dilatação e erosão numa só passagem, seguro no lugar)
+    vc_binary_close(imagemBinaria, imagemBinaria, 3);
+
+    // Preencher os buracos deixados pelos reflexos e pelo relevo (a área passa a ser a da moeda inteira)
+    vc_binary_fill_holes(imagemBinaria, imagemBinaria);
 
     // Libertar memória
-    vc_image_free(imagemGray);
+    if (imagemGray != imagemOriginal) vc_image_free(imagemGray);
     vc_image_free(imagemFiltrada);
 }
 
+// Função para detectar moedas em modo pirâmide: segmentação e etiquetagem na imagem reduzida
+// e refinamento (área, perímetro, classificação) apenas na caixa de cada moeda em resolução total
+int detectarMoedasPiramide(ContextoDeteccao& ctx, IVC* imagem, int fator, Deteccoes& moedas) {
+    int numMoedas = 0;
+    Deteccoes& candidatos = ctx.candidatos;
+    Deteccoes& refinadas = ctx.refinadas;
 
-// Função para desenhar informações na imagem
-void desenharInformacoes(cv::Mat frame, InfoMoeda* moedas, int numMoedas) {
-    int i;
-    char texto[100];
-    double valorTotal = 0.0;
-    
-    // Contar moedas por tipo
-    int count_1c = 0, count_2c = 0, count_5c = 0, count_10c = 0;
-    int count_20c = 0, count_50c = 0, count_1e = 0, count_2e = 0;
-    
-    for (i = 0; i < numMoedas; i++) {
-        // Desenhar caixa delimitadora manualmente
-        for (int j = moedas[i].x1; j <= moedas[i].x2; j++) {
-            frame.at<cv::Vec3b>(moedas[i].y1, j) = cv::Vec3b(0, 255, 0); // Linha superior
-            frame.at<cv::Vec3b>(moedas[i].y2, j) = cv::Vec3b(0, 255, 0); // Linha inferior
-        }
-        for (int j = moedas[i].y1; j <= moedas[i].y2; j++) {
-            frame.at<cv::Vec3b>(j, moedas[i].x1) = cv::Vec3b(0, 255, 0); // Linha esquerda
-            frame.at<cv::Vec3b>(j, moedas[i].x2) = cv::Vec3b(0, 255, 0); // Linha direita
+    // Nível reduzido (a imagem binária fica no contexto: é reutilizada e pode ser gravada para depuração)
+    IVC* reduzida = vc_image_new(imagem->width / fator, imagem->height / fator, imagem->channels, 255);
+    IVC*& reduzidaBinaria = ctx.binariaReduzida;
+    if (reduzidaBinaria != NULL && (reduzidaBinaria->width != imagem->width / fator || reduzidaBinaria->height != imagem->height / fator)) {
+        reduzidaBinaria = vc_image_free(reduzidaBinaria);
+    }
+    if (reduzidaBinaria == NULL) reduzidaBinaria = vc_image_new(imagem->width / fator, imagem->height / fator, 1, 255);
+    if (reduzida == NULL || reduzidaBinaria == NULL) {
+        vc_image_free(reduzida);
+        return 0;
+    }
+
+    vc_image_downscale(imagem, reduzida, fator);
+    segmentarImagem(reduzida, reduzidaBinaria, fator);
+    candidatos.limpar();
+    int numCandidatos = detectarMoedas(ctx, reduzida, reduzidaBinaria, candidatos, 300 / (fator * fator));
+
+    vc_image_free(reduzida);
+
+    // Refinamento em resolução total, apenas dentro da caixa (ampliada) de cada candidato
+    // A margem cobre a borda que o limiar adaptativo (janela de 15 px) deixa a preto no recorte
+    int margem = std::max(2 * fator, 15 / 2 + 1);
+    for (int i = 0; i < numCandidatos; i++) {
+        int x1 = candidatos.x1[i] * fator - margem;
+        int y1 = candidatos.y1[i] * fator - margem;
+        int x2 = (candidatos.x2[i] + 1) * fator + margem;
+        int y2 = (candidatos.y2[i] + 1) * fator + margem;
+        if (x1 < 0) x1 = 0;
+        if (y1 < 0) y1 = 0;
+        if (x2 > imagem->width) x2 = imagem->width;
+        if (y2 > imagem->height) y2 = imagem->height;
+
+        IVC* roi = vc_image_new(x2 - x1, y2 - y1, imagem->channels, 255);
+        IVC* roiBinaria = vc_image_new(x2 - x1, y2 - y1, 1, 255);
+        if (roi == NULL || roiBinaria == NULL) {
+            vc_image_free(roi);
+            vc_image_free(roiBinaria);
+            continue;
         }
-        
-        // Desenhar ponto central
-        frame.at<cv::Vec3b>(moedas[i].y, moedas[i].x) = cv::Vec3b(0, 0, 255);
-        
-        // Exibir tipo de moeda
-        if (moedas[i].tipo < 100) {
-            sprintf(texto, "%d cents", moedas[i].tipo);
-        } else {
-            sprintf(texto, "%d euros", moedas[i].tipo / 100);
+
+        vc_image_crop(imagem, roi, x1, y1);
+        segmentarImagem(roi, roiBinaria, 1);
+        refinadas.limpar();
+        int numRefinadas = detectarMoedas(ctx, roi, roiBinaria, refinadas, 300);
+
+        // Ficar com a maior região encontrada na caixa
+        int melhor = -1;
+        for (int j = 0; j < numRefinadas; j++) {
+            if (melhor < 0 || refinadas.area[j] > refinadas.area[melhor]) melhor = j;
         }
-        
-        cv::putText(frame, texto, cv::Point(moedas[i].x - 30, moedas[i].y - 20), 
-                   cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 255, 255), 1);
-        
-        // Acumular valor total
-        valorTotal += moedas[i].valor;
-        
-        // Contar por tipo
-        switch (moedas[i].tipo) {
-            case 1: count_1c++; break;
-            case 2: count_2c++; break;
-            case 5: count_5c++; break;
-            case 10: count_10c++; break;
-            case 20: count_20c++; break;
-            case 50: count_50c++; break;
-            case 100: count_1e++; break;
-            case 200: count_2e++; break;
+
+        // Passar para coordenadas da imagem completa
+        if (melhor >= 0) {
+            moedas.copiar(refinadas, melhor, x1, y1);
+            numMoedas++;
         }
+
+        vc_image_free(roi);
+        vc_image_free(roiBinaria);
     }
-    
-    // Exibir estatísticas
-    int y_pos = 150;
-    
+
+    return numMoedas;
+}
+
+// Sobreposições em cache: o painel de estatísticas só é redesenhado (putText) quando as
+// contagens mudam, e o rótulo de cada denominação é desenhado uma única vez
+struct CacheSobreposicao {
+    int contagens[10] = { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 }; // Estado do painel em cache
+    SVC* painel = NULL;
+    std::map<int, SVC*> rotulos;        // Rótulo por tipo de moeda
+    std::map<int, int> alturaRotulos;   // Altura do texto acima da linha de base
+
+    CacheSobreposicao() = default;
+    CacheSobreposicao(const CacheSobreposicao&) = delete;
+    CacheSobreposicao& operator=(const CacheSobreposicao&) = delete;
+    ~CacheSobreposicao() {
+        vc_sprite_free(painel);
+        for (auto& rotulo : rotulos) vc_sprite_free(rotulo.second);
+    }
+};
+
+// Tipos de moeda mostrados no painel, pela ordem do painel
+static const int tiposPainel[8] = { 1, 2, 5, 10, 20, 50, 100, 200 };
+static const char* nomesPainel[8] = { "1 cent", "2 cents", "5 cents", "10 cents", "20 cents", "50 cents", "1 euro", "2 euros" };
+
+// Função para converter uma imagem BGRA (cv::Mat) num sprite
+static SVC* criarSprite(cv::Mat& bgra) {
+    IVC vista = { bgra.data, bgra.cols, bgra.rows, 4, 255, (int)bgra.step };
+    return vc_sprite_new(&vista);
+}
+
+// Função para desenhar o painel de estatísticas num sprite BGRA
+// contagens: 8 contagens por tipo, total de moedas e valor total em cêntimos
+static SVC* desenharPainel(const int* contagens) {
+    char texto[100];
+    int numMoedas = contagens[8];
+    double valorTotal = contagens[9] / 100.0;
+    int linhas = 2;
+
+    for (int t = 0; t < 8; t++) {
+        if (contagens[t] > 0) linhas++;
+    }
+
+    // Cada linha ocupa 25 pixels; a caixa de cada linha vai de y - 20 a y + 5
+    cv::Mat bgra(25 * (linhas - 1) + 26, 281, CV_8UC4, cv::Scalar(0, 0, 0, 0));
+    int y_pos = 20;
+
     // Total de moedas
     sprintf(texto, "Total moedas: %d", numMoedas);
-    cv::rectangle(frame, cv::Point(20, y_pos - 20), cv::Point(300, y_pos + 5), cv::Scalar(0, 0, 0), cv::FILLED);
-    cv::putText(frame, texto, cv::Point(20, y_pos), 
-               cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(255, 255, 255), 1);
+    cv::rectangle(bgra, cv::Point(0, y_pos - 20), cv::Point(280, y_pos + 5), cv::Scalar(0, 0, 0, 255), cv::FILLED);
+    cv::putText(bgra, texto, cv::Point(0, y_pos), 
+               cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(255, 255, 255, 255), 1);
     y_pos += 25;
     
     // Valor total
     sprintf(texto, "Valor total: %.2f euros", valorTotal);
-    cv::rectangle(frame, cv::Point(20, y_pos - 20), cv::Point(300, y_pos + 5), cv::Scalar(0, 0, 0), cv::FILLED);
-    cv::putText(frame, texto, cv::Point(20, y_pos), 
-               cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(255, 255, 255), 1);
+    cv::rectangle(bgra, cv::Point(0, y_pos - 20), cv::Point(280, y_pos + 5), cv::Scalar(0, 0, 0, 255), cv::FILLED);
+    cv::putText(bgra, texto, cv::Point(0, y_pos), 
+               cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(255, 255, 255, 255), 1);
     y_pos += 25;
     
-    // Exibir contagem por tipo
-    if (count_1c > 0) {
-        sprintf(texto, "1 cent: %d", count_1c);
-        cv::rectangle(frame, cv::Point(20, y_pos - 20), cv::Point(300, y_pos + 5), cv::Scalar(0, 0, 0), cv::FILLED);
-        cv::putText(frame, texto, cv::Point(20, y_pos), 
-                   cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(255, 255, 255), 1);
-        y_pos += 25;
+    // Contagem por tipo
+    for (int t = 0; t < 8; t++) {
+        if (contagens[t] > 0) {
+            sprintf(texto, "%s: %d", nomesPainel[t], contagens[t]);
+            cv::rectangle(bgra, cv::Point(0, y_pos - 20), cv::Point(280, y_pos + 5), cv::Scalar(0, 0, 0, 255), cv::FILLED);
+            cv::putText(bgra, texto, cv::Point(0, y_pos), 
+                       cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(255, 255, 255, 255), 1);
+            y_pos += 25;
+        }
     }
-    
-    if (count_2c > 0) {
-        sprintf(texto, "2 cents: %d", count_2c);
-        cv::rectangle(frame, cv::Point(20, y_pos - 20), cv::Point(300, y_pos + 5), cv::Scalar(0, 0, 0), cv::FILLED);
-        cv::putText(frame, texto, cv::Point(20, y_pos), 
-                   cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(255, 255, 255), 1);
-        y_pos += 25;
+
+    return criarSprite(bgra);
+}
+
+// Função para obter (e criar na primeira utilização) o rótulo de um tipo de moeda
+static SVC* obterRotulo(CacheSobreposicao& cache, int tipo) {
+    auto it = cache.rotulos.find(tipo);
+    if (it != cache.rotulos.end()) return it->second;
+
+    char texto[100];
+    int baseline = 0;
+
+    if (tipo < 100) {
+        sprintf(texto, "%d cents", tipo);
+    } else {
+        sprintf(texto, "%d euros", tipo / 100);
     }
+
+    cv::Size tamanho = cv::getTextSize(texto, cv::FONT_HERSHEY_SIMPLEX, 0.5, 1, &baseline);
+    cv::Mat bgra(tamanho.height + baseline, tamanho.width, CV_8UC4, cv::Scalar(0, 0, 0, 0));
+    cv::putText(bgra, texto, cv::Point(0, tamanho.height), 
+               cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(255, 255, 255, 255), 1);
+
+    SVC* rotulo = criarSprite(bgra);
+    cache.rotulos[tipo] = rotulo;
+    cache.alturaRotulos[tipo] = tamanho.height;
+
+    return rotulo;
+}
+
+// Função para desenhar informações na imagem
+void desenharInformacoes(cv::Mat frame, const Deteccoes& moedas, CacheSobreposicao& cache) {
+    int numMoedas = moedas.n;
+    int contagens[10] = { 0 }; // Por tipo, total de moedas e valor total em cêntimos
     
-    if (count_5c > 0) {
-        sprintf(texto, "5 cents: %d", count_5c);
-        cv::rectangle(frame, cv::Point(20, y_pos - 20), cv::Point(300, y_pos + 5), cv::Scalar(0, 0, 0), cv::FILLED);
-        cv::putText(frame, texto, cv::Point(20, y_pos), 
-                   cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(255, 255, 255), 1);
-        y_pos += 25;
-    }
+    // Desenhar caixas delimitadoras e centros de todas as moedas de uma vez (recortado às margens)
+    IVC vista = { frame.data, frame.cols, frame.rows, 3, 255, (int)frame.step };
+    const unsigned char verde[3] = { 0, 255, 0 };
+    const unsigned char vermelho[3] = { 0, 0, 255 };
+    vc_draw_detections(&vista, numMoedas, moedas.x1.data(), moedas.y1.data(), moedas.x2.data(), moedas.y2.data(),
+                       moedas.x.data(), moedas.y.data(), NULL, verde, vermelho, 0);
     
-    if (count_10c > 0) {
-        sprintf(texto, "10 cents: %d", count_10c);
-        cv::rectangle(frame, cv::Point(20, y_pos - 20), cv::Point(300, y_pos + 5), cv::Scalar(0, 0, 0), cv::FILLED);
-        cv::putText(frame, texto, cv::Point(20, y_pos), 
-                   cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(255, 255, 255), 1);
-        y_pos += 25;
+    for (int i = 0; i < numMoedas; i++) {
+        // Exibir tipo de moeda (rótulo em cache; linha de base em (x - 30, y - 20))
+        SVC* rotulo = obterRotulo(cache, moedas.tipo[i]);
+        vc_sprite_blit(&vista, rotulo, moedas.x[i] - 30, moedas.y[i] - 20 - cache.alturaRotulos[moedas.tipo[i]]);
+        
+        // Acumular valor total e contar por tipo
+        contagens[9] += moedas.tipo[i];
+        for (int t = 0; t < 8; t++) {
+            if (moedas.tipo[i] == tiposPainel[t]) {
+                contagens[t]++;
+                break;
+            }
+        }
     }
     
-    if (count_20c > 0) {
-        sprintf(texto, "20 cents: %d", count_20c);
-        cv::rectangle(frame, cv::Point(20, y_pos - 20), cv::Point(300, y_pos + 5), cv::Scalar(0, 0, 0), cv::FILLED);
-        cv::putText(frame, texto, cv::Point(20, y_pos), 
-                   cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(255, 255, 255), 1);
-        y_pos += 25;
+    // Exibir estatísticas: o painel só é redesenhado quando as contagens mudam
+    contagens[8] = numMoedas;
+    if (cache.painel == NULL || memcmp(contagens, cache.contagens, sizeof(contagens)) != 0) {
+        vc_sprite_free(cache.painel);
+        cache.painel = desenharPainel(contagens);
+        memcpy(cache.contagens, contagens, sizeof(contagens));
     }
-    
-    if (count_50c > 0) {
-        sprintf(texto, "50 cents: %d", count_50c);
-        cv::rectangle(frame, cv::Point(20, y_pos - 20), cv::Point(300, y_pos + 5), cv::Scalar(0, 0, 0), cv::FILLED);
-        cv::putText(frame, texto, cv::Point(20, y_pos), 
-                   cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(255, 255, 255), 1);
-        y_pos += 25;
+    vc_sprite_blit(&vista, cache.painel, 20, 130);
+}
+
+// Formato dos frames em modo luma (depende do que o backend entrega com CAP_PROP_CONVERT_RGB desligado)
+// Um frame 4:2:0 tem a mesma forma em I420 (U e V separados) e em NV12 (UV intercalados): só o
+// FOURCC do backend (ou --luma-formato) os distingue
+enum FormatoLuma { LUMA_BGR, LUMA_CINZENTO, LUMA_I420, LUMA_NV12, LUMA_YUYV };
+static const char* nomesLuma[] = { "BGR (conversão não desligada)", "cinzento", "YUV 4:2:0 planar (I420)",
+                                   "YUV 4:2:0 semiplanar (NV12)", "YUYV 4:2:2" };
+
+static FormatoLuma formatoLuma(const cv::Mat& bruto, int altura, bool nv12) {
+    if (bruto.type() == CV_8UC1 && bruto.rows == altura * 3 / 2) return nv12 ? LUMA_NV12 : LUMA_I420;
+    if (bruto.type() == CV_8UC1) return LUMA_CINZENTO;
+    if (bruto.type() == CV_8UC2) return LUMA_YUYV;
+    return LUMA_BGR;
+}
+
+// Função para obter o plano de luminância como imagem IVC (sem cópia quando o frame é YUV planar)
+static void obterLuma(const cv::Mat& bruto, FormatoLuma formato, int altura, cv::Mat& cinzento, IVC* luma) {
+    if (formato == LUMA_I420 || formato == LUMA_NV12 || formato == LUMA_CINZENTO) cinzento = bruto.rowRange(0, altura);
+    else if (formato == LUMA_YUYV) cv::extractChannel(bruto, cinzento, 0);
+    else cv::cvtColor(bruto, cinzento, cv::COLOR_BGR2GRAY);
+
+    luma->data = cinzento.data;
+    luma->width = cinzento.cols;
+    luma->height = cinzento.rows;
+    luma->channels = 1;
+    luma->levels = 255;
+    luma->bytesperline = (int)cinzento.step;
+}
+
+static inline unsigned char saturar(int v) {
+    return (unsigned char)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+// Função para converter para BGR apenas uma região do frame bruto (por exemplo, a caixa de uma moeda)
+static void corRegiao(const cv::Mat& bruto, FormatoLuma formato, int largura, int altura, cv::Rect r, cv::Mat& destino) {
+    if (r.x < 0) { r.width += r.x; r.x = 0; }
+    if (r.y < 0) { r.height += r.y; r.y = 0; }
+    if (r.x + r.width > largura) r.width = largura - r.x;
+    if (r.y + r.height > altura) r.height = altura - r.y;
+    if (r.width <= 0 || r.height <= 0) return;
+
+    if (formato == LUMA_I420 || formato == LUMA_NV12) {
+        // Plano Y seguido da crominância (metade da resolução); BT.601, gama limitada
+        // I420: planos U e V, cada linha com meio passo; NV12: um plano com U e V intercalados
+        size_t passo = bruto.step;
+        const unsigned char* planoU = bruto.data + passo * altura;
+        const unsigned char* planoV = planoU + (passo / 2) * (altura / 2);
+        size_t passoUV = passo / 2;
+        int par = 1;
+        if (formato == LUMA_NV12) {
+            planoV = planoU + 1;
+            passoUV = passo;
+            par = 2;
+        }
+        for (int y = r.y; y < r.y + r.height; y++) {
+            const unsigned char* linhaY = bruto.data + (size_t)y * passo;
+            const unsigned char* linhaU = planoU + (size_t)(y / 2) * passoUV;
+            const unsigned char* linhaV = planoV + (size_t)(y / 2) * passoUV;
+            unsigned char* saida = destino.ptr(y);
+            for (int x = r.x; x < r.x + r.width; x++) {
+                int c = 298 * (linhaY[x] - 16);
+                int d = linhaU[(x / 2) * par] - 128;
+                int e = linhaV[(x / 2) * par] - 128;
+                saida[x * 3] = saturar((c + 516 * d + 128) >> 8);
+                saida[x * 3 + 1] = saturar((c - 100 * d - 208 * e + 128) >> 8);
+                saida[x * 3 + 2] = saturar((c + 409 * e + 128) >> 8);
+            }
+        }
+    } else if (formato == LUMA_YUYV) {
+        // Cada par de píxeis partilha U e V: a região começa e acaba num par
+        if (r.x % 2) { r.x--; r.width++; }
+        if (r.width % 2 && r.x + r.width < largura) r.width++;
+        cv::Mat cor;
+        cv::cvtColor(bruto(r), cor, cv::COLOR_YUV2BGR_YUY2);
+        cv::Mat alvo = destino(r);
+        cor.copyTo(alvo);
+    } else if (formato == LUMA_BGR) {
+        cv::Mat alvo = destino(r);
+        bruto(r).copyTo(alvo);
     }
-    
-    if (count_1e > 0) {
-        sprintf(texto, "1 euro: %d", count_1e);
-        cv::rectangle(frame, cv::Point(20, y_pos - 20), cv::Point(300, y_pos + 5), cv::Scalar(0, 0, 0), cv::FILLED);
-        cv::putText(frame, texto, cv::Point(20, y_pos), 
-                   cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(255, 255, 255), 1);
-        y_pos += 25;
+}
+
+// Resultado de um frame (modo offline): contagens por tipo e valor total
+struct ResultadoFrame {
+    int nframe;
+    int numMoedas;
+    int valor;                          // Cêntimos
+    int contagens[8];                   // Pela ordem de tiposPainel
+};
+
+// Função para resumir as moedas classificadas de um frame
+static ResultadoFrame resumirFrame(int nframe, const Deteccoes& moedas) {
+    ResultadoFrame r = {};
+    r.nframe = nframe;
+    r.numMoedas = moedas.n;
+    for (int i = 0; i < moedas.n; i++) {
+        r.valor += moedas.tipo[i];
+        for (int t = 0; t < 8; t++) {
+            if (moedas.tipo[i] == tiposPainel[t]) {
+                r.contagens[t]++;
+                break;
+            }
+        }
     }
-    
-    if (count_2e > 0) {
-        sprintf(texto, "2 euros: %d", count_2e);
-        cv::rectangle(frame, cv::Point(20, y_pos - 20), cv::Point(300, y_pos + 5), cv::Scalar(0, 0, 0), cv::FILLED);
-        cv::putText(frame, texto, cv::Point(20, y_pos), 
-                   cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(255, 255, 255), 1);
+    return r;
+}
+
+// Função para escrever os resultados por frame num ficheiro CSV
+static bool escreverResultados(const char* ficheiro, const std::vector<ResultadoFrame>& resultados) {
+    FILE* f = fopen(ficheiro, "w");
+    if (f == NULL) {
+        vc_log(VC_LOG_ERRO, "Erro ao criar o ficheiro de resultados '%s'!\n", ficheiro);
+        return false;
+    }
+
+    fprintf(f, "frame;moedas;valor");
+    for (int t = 0; t < 8; t++) fprintf(f, ";%d", tiposPainel[t]);
+    fprintf(f, "\n");
+    for (const ResultadoFrame& r : resultados) {
+        fprintf(f, "%d;%d;%d", r.nframe, r.numMoedas, r.valor);
+        for (int t = 0; t < 8; t++) fprintf(f, ";%d", r.contagens[t]);
+        fprintf(f, "\n");
+    }
+
+    fclose(f);
+    return true;
+}
+
+// Grafo de processamento por omissão (resolução total): a cadeia de segmentarImagem() seguida da deteção.
+// Com a análise de vida, as cinco imagens intermédias ocupam apenas dois buffers.
+static const char* grafoPorOmissao =
+    "cinza = cinzento(entrada)\n"
+    "suave = gaussiano(cinza) raio=2\n"
+    "binaria = limiar_adaptativo(suave) janela=15 deslocamento=20\n"
+    "fechada = fechar(binaria) tamanho=3\n"
+    "cheia = preencher(fechada)\n"
+    "detetar(entrada, cheia) area=300\n";
+
+// Função para ler a descrição de um grafo de um ficheiro
+static bool lerGrafo(const char* ficheiro, std::string& descricao) {
+    std::ifstream f(ficheiro);
+    if (!f) {
+        vc_log(VC_LOG_ERRO, "Não foi possível abrir o grafo '%s'!\n", ficheiro);
+        return false;
     }
+    std::stringstream texto;
+    texto << f.rdbuf();
+    descricao = texto.str();
+    return true;
 }
 
-int main(void) {
+// Função para registar a etapa final de deteção (etiquetagem e características) de um grafo.
+// Com gravador de depuração, a imagem binária é submetida na própria etapa (o buffer pode ser reutilizado depois).
+static void registarDeteccao(GrafoProcessamento& grafo, ContextoDeteccao& contexto, Deteccoes& moedas,
+                             GravadorDepuracao* depuracao = NULL, const int* nframe = NULL, const int* numMoedasAnterior = NULL) {
+    grafo.registarTipo("detetar", 2, 0, [&contexto, &moedas, depuracao, nframe, numMoedasAnterior]
+                       (const std::vector<IVC*>& e, IVC*, const GrafoProcessamento::Parametros& p) {
+        if (e[1]->channels != 1) return false;
+        contexto.separacao = GrafoProcessamento::parametro(p, "separacao", 50) / 100.0f;
+        detectarMoedas(contexto, e[0], e[1], moedas, GrafoProcessamento::parametro(p, "area", 300));
+
+        if (depuracao != NULL) {
+            // Anomalia: regiões rejeitadas ou contagem diferente do frame anterior
+            bool anomalia = moedas.rejeitadas > 0 || moedas.n != *numMoedasAnterior;
+            depuracao->submeter(*nframe, e[1], "debug_binaria", anomalia);
+        }
+        return true;
+    });
+}
+
+// Função para processar um segmento [inicio, fim) do vídeo com uma captura própria (modo paralelo)
+// A tabela é copiada: a classificação guarda resultados intermédios na tabela
+static void processarSegmento(const char* videofile, int inicio, int fim, TabelaMoedas tabela, int fatorPiramide,
+                              const std::string* descricaoGrafo, std::vector<ResultadoFrame>* resultados) {
+    cv::VideoCapture captura(videofile);
+    if (!captura.isOpened()) {
+        vc_log(VC_LOG_ERRO, "Segmento %d-%d: erro ao abrir o vídeo!\n", inicio, fim);
+        return;
+    }
+
+    // O backend salta para o keyframe anterior e descodifica até ao frame pedido, mas nalguns fluxos
+    // (FFmpeg) fica uns frames ao lado: antes do início descodifica-se até lá; depois, o segmento falha
+    if (inicio > 0) {
+        captura.set(cv::CAP_PROP_POS_FRAMES, inicio);
+        int posicao = (int)captura.get(cv::CAP_PROP_POS_FRAMES);
+        for (int k = posicao; k < inicio; k++) {
+            if (!captura.grab()) break;
+        }
+        if (posicao < inicio) posicao = (int)captura.get(cv::CAP_PROP_POS_FRAMES);
+        if (posicao != inicio) {
+            vc_log(VC_LOG_ERRO, "Segmento %d-%d: o posicionamento parou no frame %d.\n", inicio, fim, posicao);
+            return;
+        }
+    }
+
+    ContextoDeteccao contexto;
+    Deteccoes moedas;
+    GrafoProcessamento grafo;
+    registarDeteccao(grafo, contexto, moedas);
+    if (!grafo.carregar(*descricaoGrafo)) return;
+    cv::Mat frame;
+    resultados->reserve(fim - inicio);
+
+    for (int k = inicio; k < fim; k++) {
+        // O número do frame vem da captura (não do contador), para os resultados nunca ficarem trocados
+        int n = (int)captura.get(cv::CAP_PROP_POS_FRAMES);
+        if (n >= fim) break;
+        if (!captura.read(frame) || frame.empty()) break;
+
+        // Vista IVC sobre o frame (sem cópia)
+        IVC imagem = { frame.data, frame.cols, frame.rows, 3, 255, (int)frame.step };
+
+        moedas.limpar();
+        if (fatorPiramide > 1) {
+            detectarMoedasPiramide(contexto, &imagem, fatorPiramide, moedas);
+        } else if (!grafo.executar(&imagem)) {
+            break;
+        }
+        classificarMoedas(tabela, moedas);
+
+        resultados->push_back(resumirFrame(n + 1, moedas));
+    }
+
+    if ((int)resultados->size() < fim - inicio) {
+        vc_log(VC_LOG_AVISO, "Segmento %d-%d: só foram lidos %d frames.\n", inicio, fim, (int)resultados->size());
+    }
+}
+
+// Função para processar um vídeo longo em N segmentos concorrentes, juntando os resultados por ordem
+static int processarParalelo(const char* videofile, int numSegmentos, const TabelaMoedas& tabela, int fatorPiramide,
+                             const std::string& descricaoGrafo, const char* ficheiroResultados) {
+    cv::VideoCapture captura(videofile);
+    if (!captura.isOpened()) {
+        vc_log(VC_LOG_ERRO, "Erro ao abrir o arquivo de vídeo!\n");
+        return 1;
+    }
+    int total = (int)captura.get(cv::CAP_PROP_FRAME_COUNT);
+    captura.release();
+
+    if (total <= 0) {
+        vc_log(VC_LOG_ERRO, "O número de frames do vídeo é desconhecido: não é possível dividi-lo em segmentos.\n");
+        return 1;
+    }
+    if (numSegmentos > total) numSegmentos = total;
+
+    vc_log(VC_LOG_INFO, "Modo paralelo: %d frames em %d segmentos.\n", total, numSegmentos);
+
+    auto inicio = std::chrono::steady_clock::now();
+
+    // Cada segmento tem a sua captura, contexto de deteção e vetor de resultados
+    std::vector<std::vector<ResultadoFrame>> partes(numSegmentos);
+    std::vector<std::thread> trabalhadores;
+    for (int i = 0; i < numSegmentos; i++) {
+        int a = (int)((long long)total * i / numSegmentos);
+        int b = (int)((long long)total * (i + 1) / numSegmentos);
+        trabalhadores.emplace_back(processarSegmento, videofile, a, b, tabela, fatorPiramide, &descricaoGrafo, &partes[i]);
+    }
+    for (std::thread& t : trabalhadores) t.join();
+
+    // Juntar por ordem de frame
+    std::vector<ResultadoFrame> resultados;
+    resultados.reserve(total);
+    for (const std::vector<ResultadoFrame>& parte : partes) resultados.insert(resultados.end(), parte.begin(), parte.end());
+
+    double segundos = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+    vc_log(VC_LOG_INFO, "Processados %d frames em %.3f s (%.1f frames/s).\n", (int)resultados.size(), segundos,
+           segundos > 0 ? resultados.size() / segundos : 0.0);
+
+    if (ficheiroResultados != NULL && !escreverResultados(ficheiroResultados, resultados)) return 1;
+    return (int)resultados.size() == total ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
     // Vídeo
     char videofile[100] = "C:/Projetos/TPProject/video1.mp4";
     cv::VideoCapture capture;
@@ -424,77 +947,320 @@ int main(void) {
     // Outros
     char str[100];
     int key = 0;
-    InfoMoeda moedas[100]; // Array para armazenar informações das moedas
-    int numMoedas = 0;    
+    Deteccoes moedas;      // Moedas detetadas no frame (memória reutilizada entre frames)
+    ContextoDeteccao contexto;
+    CacheSobreposicao sobreposicao;
+    int fatorPiramide = 1; // 1 = resolução total; 2 ou 4 = modo pirâmide
+    const char* ficheiroTabela = "denominacoes.txt";
+    TabelaMoedas tabela;
+    GravadorDepuracao::Opcoes opcoesDepuracao;
+    int numMoedasAnterior = -1;
+    int nivelLog = VC_LOG_INFO;
+    FonteFrames::Opcoes opcoesEntrada;
+    const char* ficheiroArquivo = NULL;       // Repetir frames de um arquivo
+    const char* ficheiroGravarArquivo = NULL; // Gravar os frames descodificados num arquivo
+    bool semJanela = false;                   // Sem janelas nem desenho (medição do processamento)
+    bool modoLuma = false;                    // Processar o plano Y do frame nativo, sem conversão para BGR
+    const char* formatoLumaPedido = NULL;     // 4:2:0 em modo luma: "i420" ou "nv12" (NULL = pelo FOURCC)
+    bool lumaNV12 = false;
+    int numSegmentos = 0;                     // Modo paralelo offline (0 = desligado)
+    const char* ficheiroResultados = NULL;    // CSV com os resultados por frame
+    const char* ficheiroGrafo = NULL;         // Descrição do grafo de processamento (resolução total)
+    std::string descricaoGrafo = grafoPorOmissao;
+    int numThreads = 1;                       // Threads das funções de vc.c (0 = todos os processadores)
+    std::vector<ResultadoFrame> resultados;
     
-    printf("Iniciando programa...\n");
-
-    // Verificar se o arquivo de vídeo existe antes de abrir
-    if (!std::filesystem::exists(videofile)) {
-        printf("Erro: O arquivo de vídeo '%s' não foi encontrado!\n", videofile);
-        return 1;
+    // Argumentos: moedas [video] [--piramide 2|4] [--tabela ficheiro]
+    //             [--depuracao pasta] [--depuracao-cada N] [--depuracao-anomalias] [--depuracao-formato pgm|png]
+    //             [--log 0-3] [--entrada caminho|-] [--entrada-bgr LARGURAxALTURA]
+    //             [--gravar-arquivo ficheiro] [--arquivo ficheiro] [--sem-janela] [--luma] [--luma-formato i420|nv12]
+    //             [--paralelo N] [--resultados ficheiro.csv] [--grafo ficheiro] [--threads N]
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--log") == 0 && i + 1 < argc) {
+            nivelLog = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--paralelo") == 0 && i + 1 < argc) {
+            numSegmentos = atoi(argv[++i]);
+            if (numSegmentos < 1) {
+                printf("Erro: o número de segmentos deve ser pelo menos 1!\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--resultados") == 0 && i + 1 < argc) {
+            ficheiroResultados = argv[++i];
+        } else if (strcmp(argv[i], "--grafo") == 0 && i + 1 < argc) {
+            ficheiroGrafo = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            numThreads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--luma") == 0) {
+            modoLuma = true;
+        } else if (strcmp(argv[i], "--luma-formato") == 0 && i + 1 < argc) {
+            formatoLumaPedido = argv[++i];
+            if (strcmp(formatoLumaPedido, "i420") != 0 && strcmp(formatoLumaPedido, "nv12") != 0) {
+                printf("Erro: formato luma desconhecido '%s' (i420 ou nv12)!\n", formatoLumaPedido);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--gravar-arquivo") == 0 && i + 1 < argc) {
+            ficheiroGravarArquivo = argv[++i];
+        } else if (strcmp(argv[i], "--arquivo") == 0 && i + 1 < argc) {
+            ficheiroArquivo = argv[++i];
+        } else if (strcmp(argv[i], "--sem-janela") == 0) {
+            semJanela = true;
+        } else if (strcmp(argv[i], "--entrada") == 0 && i + 1 < argc) {
+            opcoesEntrada.caminho = argv[++i];
+        } else if (strcmp(argv[i], "--entrada-bgr") == 0 && i + 1 < argc) {
+            i++;
+            if (sscanf(argv[i], "%dx%d", &opcoesEntrada.largura, &opcoesEntrada.altura) != 2 ||
+                opcoesEntrada.largura <= 0 || opcoesEntrada.altura <= 0) {
+                printf("Erro: dimensões inválidas '%s' (LARGURAxALTURA)!\n", argv[i]);
+                return 1;
+            }
+            opcoesEntrada.formato = FonteFrames::FORMATO_BGR;
+        } else if (strcmp(argv[i], "--tabela") == 0 && i + 1 < argc) {
+            ficheiroTabela = argv[++i];
+        } else if (strcmp(argv[i], "--depuracao") == 0 && i + 1 < argc) {
+            opcoesDepuracao.pasta = argv[++i];
+        } else if (strcmp(argv[i], "--depuracao-cada") == 0 && i + 1 < argc) {
+            opcoesDepuracao.cadaN = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--depuracao-anomalias") == 0) {
+            opcoesDepuracao.soAnomalias = true;
+        } else if (strcmp(argv[i], "--depuracao-formato") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "png") == 0) opcoesDepuracao.formato = GravadorDepuracao::FORMATO_PNG;
+            else if (strcmp(argv[i], "pgm") == 0) opcoesDepuracao.formato = GravadorDepuracao::FORMATO_PGM;
+            else {
+                printf("Erro: formato de depuração desconhecido '%s' (pgm ou png)!\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--piramide") == 0 && i + 1 < argc) {
+            fatorPiramide = atoi(argv[++i]);
+            if (fatorPiramide != 2 && fatorPiramide != 4) {
+                printf("Erro: o fator da pirâmide deve ser 2 ou 4!\n");
+                return 1;
+            }
+        } else {
+            snprintf(videofile, sizeof(videofile), "%s", argv[i]);
+        }
     }
     
-    // Abrir o arquivo de vídeo
-    capture.open(videofile);
+    // Registo assíncrono (as mensagens por frame não bloqueiam o processamento)
+    vc_log_start(nivelLog);
+    atexit(vc_log_stop);
     
-    // Verificar se o vídeo existe
-if (!std::filesystem::exists(videofile)) {
-    printf("Erro: O arquivo de vídeo '%s' não foi encontrado!\n", videofile);
-    return 1;
-}
-    printf("Arquivo de vídeo encontrado.\n");
+    vc_log(VC_LOG_INFO, "Iniciando programa...\n");
+    
+    // Variantes dos kernels para este CPU (antes de criar threads)
+    vc_log(VC_LOG_INFO, "Kernels: %s.\n", vc_cpu_level_name(vc_cpu_init()));
+    vc_threads_set(numThreads);
+    if (numThreads != 1) vc_log(VC_LOG_INFO, "Threads de vc.c: %d.\n", vc_threads_get());
+    
+    // O modo luma só se aplica à descodificação pelo cv::VideoCapture
+    if (modoLuma && (ficheiroArquivo != NULL || !opcoesEntrada.caminho.empty() || ficheiroGravarArquivo != NULL)) {
+        vc_log(VC_LOG_AVISO, "--luma é ignorado com --arquivo, --entrada ou --gravar-arquivo.\n");
+        modoLuma = false;
+    }
+    
+    // Carregar a tabela de denominações (afinar sem recompilar); com erro, ficam os valores por omissão
+    carregarTabelaMoedas(ficheiroTabela, tabela);
+    
+    // Imagens de depuração: gravadas por uma thread própria, com amostragem
+    // (criadas antes do grafo, cuja etapa 'detetar' as submete; o modo paralelo não as grava)
+    GravadorDepuracao::Opcoes opcoesGravador = opcoesDepuracao;
+    if (numSegmentos > 0) opcoesGravador.pasta.clear();
+    GravadorDepuracao depuracao(opcoesGravador);
+    if (depuracao.falhou()) return 1;
 
-    // Verificar se foi possível abrir o arquivo de vídeo
-    if (!capture.isOpened()) {
-        printf("Erro ao abrir o arquivo de vídeo!\n");
+    // Grafo de processamento: etapas declaradas num ficheiro (trocar ou reordenar sem recompilar)
+    GrafoProcessamento grafo;
+    registarDeteccao(grafo, contexto, moedas, &depuracao, &video.nframe, &numMoedasAnterior);
+    if (ficheiroGrafo != NULL && !lerGrafo(ficheiroGrafo, descricaoGrafo)) return 1;
+    if (!grafo.carregar(descricaoGrafo)) return 1;
+    if (fatorPiramide > 1) {
+        if (ficheiroGrafo != NULL) vc_log(VC_LOG_AVISO, "--grafo é ignorado no modo pirâmide.\n");
+    } else {
+        grafo.descrever();
+    }
+    
+    // Modo paralelo: processamento offline do vídeo em segmentos concorrentes, sem janela
+    if (numSegmentos > 0) {
+        if (ficheiroArquivo != NULL || !opcoesEntrada.caminho.empty() || ficheiroGravarArquivo != NULL || modoLuma ||
+            !opcoesDepuracao.pasta.empty()) {
+            vc_log(VC_LOG_AVISO, "--paralelo só usa o vídeo: as opções de entrada, arquivo, luma e depuração são ignoradas.\n");
+        }
+        if (!std::filesystem::exists(videofile)) {
+            vc_log(VC_LOG_ERRO, "O arquivo de vídeo '%s' não foi encontrado!\n", videofile);
+            return 1;
+        }
+        return processarParalelo(videofile, numSegmentos, tabela, fatorPiramide, descricaoGrafo, ficheiroResultados);
+    }
+    
+    // Arquivo de frames já descodificados, mapeado em memória
+    std::unique_ptr<ArquivoFrames> arquivo;
+    // Fluxo de frames (stdin/FIFO): dispensa o cv::VideoCapture e a descodificação
+    std::unique_ptr<FonteFrames> fonte;
+    if (ficheiroArquivo != NULL) {
+        arquivo.reset(new ArquivoFrames(ficheiroArquivo));
+        if (!arquivo->aberto()) return 1;
+        
+        IVC primeiro = { NULL, 0, 0, 0, 0, 0 };
+        arquivo->frame(0, &primeiro);
+        video.ntotalframes = arquivo->frames();
+        video.fps = 0;
+        video.width = primeiro.width;
+        video.height = primeiro.height;
+        video.nframe = 0;
+        vc_log(VC_LOG_INFO, "Arquivo '%s': %d frames, %dx%d\n", ficheiroArquivo, video.ntotalframes, video.width, video.height);
+    } else if (!opcoesEntrada.caminho.empty()) {
+        fonte.reset(new FonteFrames(opcoesEntrada));
+        if (!fonte->aberta()) return 1;
+        
+        // Número de frames, fps e dimensões só são conhecidos à medida que se lê
+        video.ntotalframes = 0;
+        video.fps = 0;
+        video.width = opcoesEntrada.largura;
+        video.height = opcoesEntrada.altura;
+        video.nframe = 0;
+        vc_log(VC_LOG_INFO, "A ler frames de '%s'.\n", opcoesEntrada.caminho.c_str());
+    } else {
+        // Verificar se o arquivo de vídeo existe antes de abrir
+        if (!std::filesystem::exists(videofile)) {
+            vc_log(VC_LOG_ERRO, "O arquivo de vídeo '%s' não foi encontrado!\n", videofile);
+            return 1;
+        }
+    
+        // Abrir o arquivo de vídeo
+        capture.open(videofile);
+    
+        // Verificar se o vídeo existe
+    if (!std::filesystem::exists(videofile)) {
+        vc_log(VC_LOG_ERRO, "O arquivo de vídeo '%s' não foi encontrado!\n", videofile);
         return 1;
     }
-    printf("Arquivo de vídeo encontrado.\n");
+        vc_log(VC_LOG_INFO, "Arquivo de vídeo encontrado.\n");
+
+        // Verificar se foi possível abrir o arquivo de vídeo
+        if (!capture.isOpened()) {
+            vc_log(VC_LOG_ERRO, "Erro ao abrir o arquivo de vídeo!\n");
+            return 1;
+        }
+        
+        // Modo luma: pedir ao backend o frame nativo (YUV), sem conversão para BGR
+        if (modoLuma && !capture.set(cv::CAP_PROP_CONVERT_RGB, 0)) {
+            vc_log(VC_LOG_AVISO, "O backend não permite desligar a conversão para BGR: a luminância será calculada a partir de BGR.\n");
+        }
+        if (modoLuma) {
+            // Sem --luma-formato, um frame 4:2:0 é NV12 só se o backend o indicar no FOURCC (senão, I420)
+            if (formatoLumaPedido != NULL) lumaNV12 = strcmp(formatoLumaPedido, "nv12") == 0;
+            else lumaNV12 = (int)capture.get(cv::CAP_PROP_FOURCC) == cv::VideoWriter::fourcc('N', 'V', '1', '2');
+        }
+        vc_log(VC_LOG_INFO, "Arquivo de vídeo encontrado.\n");
 
-    // Obter propriedades do vídeo
-    printf("Obtendo propriedades do vídeo...\n");
-    video.ntotalframes = (int)capture.get(cv::CAP_PROP_FRAME_COUNT);
-    video.fps = (int)capture.get(cv::CAP_PROP_FPS);
-    video.width = (int)capture.get(cv::CAP_PROP_FRAME_WIDTH);
-    video.height = (int)capture.get(cv::CAP_PROP_FRAME_HEIGHT);
+        // Obter propriedades do vídeo
+        vc_log(VC_LOG_INFO, "Obtendo propriedades do vídeo...\n");
+        video.ntotalframes = (int)capture.get(cv::CAP_PROP_FRAME_COUNT);
+        video.fps = (int)capture.get(cv::CAP_PROP_FPS);
+        video.width = (int)capture.get(cv::CAP_PROP_FRAME_WIDTH);
+        video.height = (int)capture.get(cv::CAP_PROP_FRAME_HEIGHT);
     
-    printf("Propriedades: %d frames, %d fps, %dx%d\n", video.ntotalframes, video.fps, video.width, video.height);
+        vc_log(VC_LOG_INFO, "Propriedades: %d frames, %d fps, %dx%d\n", video.ntotalframes, video.fps, video.width, video.height);
+    }
+
+    // Gravação dos frames descodificados (para repetir depois com --arquivo)
+    std::unique_ptr<GravadorArquivo> gravadorArquivo;
+    if (ficheiroGravarArquivo != NULL) {
+        gravadorArquivo.reset(new GravadorArquivo(ficheiroGravarArquivo));
+        if (!gravadorArquivo->aberto()) return 1;
+    }
 
     // Criar janela para exibir o vídeo
-    printf("Criando janela...\n");
-    cv::namedWindow("Detector de Moedas", cv::WINDOW_AUTOSIZE);
+    if (!semJanela) {
+        vc_log(VC_LOG_INFO, "Criando janela...\n");
+        cv::namedWindow("Detector de Moedas", cv::WINDOW_AUTOSIZE);
+    }
     
-    printf("Entrando no loop principal...\n");
+    vc_log(VC_LOG_INFO, "Entrando no loop principal...\n");
 
     // Iniciar o timer
     // vc_timer();
     
     cv::Mat frame;
+    cv::Mat bruto, cinzento;       // Modo luma: frame nativo do backend e plano Y (também a vista dos frames P5)
+    FormatoLuma formato = LUMA_BGR;
+    IVC vistaArquivo, vistaLuma;
+    int framesProcessados = 0;
+    auto inicio = std::chrono::steady_clock::now();
     while (key != 'q') {
-        // Ler um frame do vídeo
-        capture.read(frame);
+        IVC* entrada = NULL;
         
-        // Verificar se conseguiu ler o frame
-        if (frame.empty()) break;
+        if (arquivo) {
+            // Frame do arquivo: vista sobre o ficheiro mapeado (sem descodificação nem cópia)
+            if (!arquivo->frame(video.nframe, &vistaArquivo)) break;
+            if (vistaArquivo.channels != 3) {
+                vc_log(VC_LOG_ERRO, "O arquivo contém frames com %d canais (esperados 3)!\n", vistaArquivo.channels);
+                break;
+            }
+            entrada = &vistaArquivo;
+            
+            video.width = entrada->width;
+            video.height = entrada->height;
+            video.nframe++;
+            frame = cv::Mat(entrada->height, entrada->width, CV_8UC3, entrada->data, entrada->bytesperline);
+        } else if (fonte) {
+            // Frame do fluxo: o cv::Mat é apenas uma vista sobre o buffer IVC (sem cópia)
+            entrada = fonte->obter();
+            if (entrada == NULL) break;
+            
+            video.width = entrada->width;
+            video.height = entrada->height;
+            video.nframe++;
+            if (entrada->channels == 1) {
+                // Frame P5: processado em cinzento, como o plano Y do modo luma
+                cinzento = cv::Mat(entrada->height, entrada->width, CV_8UC1, entrada->data, entrada->bytesperline);
+                if (!semJanela || gravadorArquivo) cv::cvtColor(cinzento, frame, cv::COLOR_GRAY2BGR);
+            } else {
+                frame = cv::Mat(entrada->height, entrada->width, CV_8UC3, entrada->data, entrada->bytesperline);
+            }
+        } else {
+            // Ler um frame do vídeo (em modo luma, o frame nativo do backend)
+            cv::Mat& lido = modoLuma ? bruto : frame;
+            capture.read(lido);
+            
+            // Verificar se conseguiu ler o frame
+            if (lido.empty()) break;
+            
+            // Número do frame atual
+            video.nframe = (int)capture.get(cv::CAP_PROP_POS_FRAMES);
+            
+            if (modoLuma) {
+                // O plano Y é a imagem processada; a cor só é convertida para a janela, nas caixas das moedas
+                formato = formatoLuma(bruto, video.height, lumaNV12);
+                if (framesProcessados == 0) vc_log(VC_LOG_INFO, "Modo luma: frames em %s.\n", nomesLuma[formato]);
+                obterLuma(bruto, formato, video.height, cinzento, &vistaLuma);
+                entrada = &vistaLuma;
+                if (!semJanela) cv::cvtColor(cinzento, frame, cv::COLOR_GRAY2BGR);
+            }
+        }
         
-        // Número do frame atual
-        video.nframe = (int)capture.get(cv::CAP_PROP_POS_FRAMES);
+        // Gravar o frame descodificado (antes de qualquer desenho) para repetição posterior
+        if (gravadorArquivo && !gravadorArquivo->acrescentar(frame.data, frame.cols, frame.rows, frame.channels(), (int)frame.step)) {
+            vc_log(VC_LOG_ERRO, "Erro ao gravar o frame %d no arquivo!\n", video.nframe);
+            break;
+        }
         
         // Exibir informações do vídeo
-        sprintf(str, "RESOLUCAO: %dx%d", video.width, video.height);
-        cv::putText(frame, str, cv::Point(20, 25), 
-                   cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(255, 255, 255), 1);
-        
-        sprintf(str, "FRAME: %d/%d", video.nframe, video.ntotalframes);
-        cv::putText(frame, str, cv::Point(20, 50), 
-                   cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(255, 255, 255), 1);
-        
-        sprintf(str, "FPS: %d", video.fps);
-        cv::putText(frame, str, cv::Point(20, 75), 
-                   cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(255, 255, 255), 1);
+        if (!semJanela) {
+            sprintf(str, "RESOLUCAO: %dx%d", video.width, video.height);
+            cv::putText(frame, str, cv::Point(20, 25), 
+                       cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(255, 255, 255), 1);
+            
+            sprintf(str, "FRAME: %d/%d", video.nframe, video.ntotalframes);
+            cv::putText(frame, str, cv::Point(20, 50), 
+                       cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(255, 255, 255), 1);
+            
+            sprintf(str, "FPS: %d", video.fps);
+            cv::putText(frame, str, cv::Point(20, 75), 
+                       cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(255, 255, 255), 1);
+        }
         
-        printf("Processando frame %d de %d...\n", video.nframe, video.ntotalframes);
+        vc_log_limited(VC_LOG_INFO, 1, "Processando frame %d de %d...\n", video.nframe, video.ntotalframes);
         
 
 /*         // SE ESTIVER NOS PRIMEIROS 20 FRAMES, apenas mostrar imagens e continuar
@@ -515,58 +1281,110 @@ if (!std::filesystem::exists(videofile)) {
     } */
 
 
-        // Criar uma nova imagem IVC
-        IVC* image = vc_image_new(video.width, video.height, 3, 255);
+        // Imagem IVC do frame: o buffer do fluxo/arquivo ou o plano Y são usados diretamente; o frame do vídeo é copiado
+        IVC* image = entrada;
         if (image == NULL) {
-            printf("Erro ao alocar memória para a imagem IVC\n");
-            break;
+            image = vc_image_new(video.width, video.height, 3, 255);
+            if (image == NULL) {
+                vc_log(VC_LOG_ERRO, "Erro ao alocar memória para a imagem IVC\n");
+                break;
+            }
+            
+            // Copiar dados da imagem de cv::Mat para IVC
+            memcpy(image->data, frame.data, video.width * video.height * 3);
         }
         
-        // Copiar dados da imagem de cv::Mat para IVC
-        memcpy(image->data, frame.data, video.width * video.height * 3);
-        
-        cv::Mat imgGray;
-        cv::cvtColor(frame, imgGray, cv::COLOR_BGR2GRAY);
-        cv::imshow("Imagem Cinza", imgGray);
+        // Sem janela não há nada a mostrar (só o processamento é medido)
+        // No modo luma (e com frames P5) a entrada já é a imagem cinzenta (sem voltar a converter o frame BGR)
+        if (!semJanela) {
+            if (modoLuma || (entrada != NULL && entrada->channels == 1)) {
+                cv::imshow("Imagem Cinza", cinzento);
+            } else {
+                cv::Mat imgGray;
+                cv::cvtColor(frame, imgGray, cv::COLOR_BGR2GRAY);
+                cv::imshow("Imagem Cinza", imgGray);
+            }
+        }
 
-        // Criar imagem binária para segmentação
-        IVC* imagemBinaria = vc_image_new(video.width, video.height, 1, 255);
-        if (imagemBinaria == NULL) {
-            printf("Erro ao alocar memória para a imagem binária\n");
-            vc_image_free(image);
-            break;
+        moedas.limpar();
+        if (fatorPiramide > 1) {
+            // Modo pirâmide: a imagem completa só é tocada nas caixas das moedas
+            detectarMoedasPiramide(contexto, image, fatorPiramide, moedas);
+
+            // A imagem binária deste modo é a do nível reduzido (o grafo, que a submete, não é usado)
+            if (depuracao.ativo() && contexto.binariaReduzida != NULL) {
+                bool anomalia = contexto.candidatos.rejeitadas > 0 || moedas.n != numMoedasAnterior;
+                depuracao.submeter(video.nframe, contexto.binariaReduzida, "debug_binaria_reduzida", anomalia);
+            }
+        } else {
+            // Segmentação e deteção pelo grafo (os buffers intermédios são reutilizados entre frames)
+            if (!grafo.executar(image)) {
+                if (entrada == NULL) vc_image_free(image);
+                else if (fonte) fonte->devolver(entrada);
+                break;
+            }
         }
         
-        // Segmentar a imagem para isolar as moedas
-        segmentarImagem(image, imagemBinaria);
+        numMoedasAnterior = moedas.n;
         
-        // Detectar moedas na imagem binária
-        cv::imwrite("C:/Projetos/TPProject/CMakeBuild/debug_binaria.png", cv::Mat(video.height, video.width, CV_8UC1, imagemBinaria->data));
-        numMoedas = detectarMoedas(image, imagemBinaria, moedas, 100);
+        // Classificar todas as moedas do frame de uma vez
+        classificarMoedas(tabela, moedas);
+        if (ficheiroResultados != NULL) resultados.push_back(resumirFrame(video.nframe, moedas));
         
-        // Desenhar informações na imagem
-        desenharInformacoes(frame, moedas, numMoedas);
+        if (!semJanela) {
+            // Modo luma: converter para cor apenas as caixas das moedas
+            if (modoLuma) {
+                for (int i = 0; i < moedas.n; i++) {
+                    cv::Rect caixa(moedas.x1[i], moedas.y1[i], moedas.x2[i] - moedas.x1[i] + 1, moedas.y2[i] - moedas.y1[i] + 1);
+                    corRegiao(bruto, formato, video.width, video.height, caixa, frame);
+                }
+            }
+            
+            // Desenhar informações na imagem
+            desenharInformacoes(frame, moedas, sobreposicao);
+            
+            // Exibir o frame
+            cv::imshow("Detector de Moedas", frame);
+        }
         
-        // Liberar memória das imagens IVC
-        vc_image_free(image);
-        vc_image_free(imagemBinaria);
+        // Liberar memória das imagens IVC (o buffer do fluxo volta ao conjunto, depois de exibido)
+        if (entrada == NULL) vc_image_free(image);
+        else if (fonte) fonte->devolver(entrada);
         
-        // Exibir o frame
-        cv::imshow("Detector de Moedas", frame);
+        framesProcessados++;
         
         // Sair se o usuário pressionar 'q'
-        key = cv::waitKey(1);
+        if (!semJanela) key = cv::waitKey(1);
+    }
+    
+    double segundos = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+    vc_log(VC_LOG_INFO, "Processados %d frames em %.3f s (%.1f frames/s).\n", framesProcessados, segundos,
+           segundos > 0 ? framesProcessados / segundos : 0.0);
+    
+    if (ficheiroResultados != NULL) escreverResultados(ficheiroResultados, resultados);
+    
+    if (gravadorArquivo) {
+        if (gravadorArquivo->fechar()) vc_log(VC_LOG_INFO, "Arquivo '%s': %d frames gravados.\n", ficheiroGravarArquivo, gravadorArquivo->frames());
     }
     
     // Parar o timer e exibir o tempo decorrido
     // vc_timer();
     
+    if (depuracao.ativo()) {
+        vc_log(VC_LOG_INFO, "Imagens de depuração: %d gravadas, %d descartadas (fila cheia).\n", depuracao.gravadas(), depuracao.descartadas());
+    }
+    
+    // Escrever as mensagens pendentes antes de esperar pelo utilizador
+    vc_log_stop();
+    
+    if (!semJanela) {
         // Fechar o arquivo de vídeo
         std::cout << "Pressione Enter para sair..." << std::endl;
         std::cin.get(); // Aguarda o utilizador pressionar Enter
     
         // Fechar a janela
         cv::destroyWindow("Detector de Moedas"); 
+    }
 
     capture.release();
     return 0;
@@ -5,12 +5,40 @@
 //                    VISÃO POR COMPUTADOR
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
+// Necessário para mmap()/madvise() quando se compila com -std=c11
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <math.h>
+#include <stdint.h>
 #include "vc.h"
+#include "vc_log.h"
+
+// Mapeamento de ficheiros em memória
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Threads (opcional: sem OpenMP as funções paralelas correm numa só thread)
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Instruções SSE2 (sempre disponíveis em x86-64)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VC_SSE2
+#endif
 
 // Funções auxiliares para leitura de imagens NetPBM
 char *netpbm_get_token(FILE *file, char *tok, int len)
@@ -46,6 +74,74 @@ char *netpbm_get_token(FILE *file, char *tok, int len)
     return tok;
 }
 
+// Tabelas de conversão PBM (um byte = 8 píxeis, o bit mais significativo é o primeiro píxel)
+// vc_pbm_unpack[b]: os 8 píxeis do byte b (bit a 1 = preto = 0; bit a 0 = branco = 1)
+#define VC_PBM_U(b) { !((b) & 0x80), !((b) & 0x40), !((b) & 0x20), !((b) & 0x10), \
+                      !((b) & 0x08), !((b) & 0x04), !((b) & 0x02), !((b) & 0x01) }
+#define VC_PBM_U4(b) VC_PBM_U(b), VC_PBM_U((b) + 1), VC_PBM_U((b) + 2), VC_PBM_U((b) + 3)
+#define VC_PBM_U16(b) VC_PBM_U4(b), VC_PBM_U4((b) + 4), VC_PBM_U4((b) + 8), VC_PBM_U4((b) + 12)
+#define VC_PBM_U64(b) VC_PBM_U16(b), VC_PBM_U16((b) + 16), VC_PBM_U16((b) + 32), VC_PBM_U16((b) + 48)
+
+static const unsigned char vc_pbm_unpack[256][8] = {
+    VC_PBM_U64(0), VC_PBM_U64(64), VC_PBM_U64(128), VC_PBM_U64(192)
+};
+
+// vc_bit_reverse[b]: o byte b com a ordem dos bits invertida (a máscara SSE2 tem o primeiro píxel no bit 0)
+#define VC_REV(b) (unsigned char)((((b) & 0x01) << 7) | (((b) & 0x02) << 5) | (((b) & 0x04) << 3) | (((b) & 0x08) << 1) | \
+                                  (((b) & 0x10) >> 1) | (((b) & 0x20) >> 3) | (((b) & 0x40) >> 5) | (((b) & 0x80) >> 7))
+#define VC_REV4(b) VC_REV(b), VC_REV((b) + 1), VC_REV((b) + 2), VC_REV((b) + 3)
+#define VC_REV16(b) VC_REV4(b), VC_REV4((b) + 4), VC_REV4((b) + 8), VC_REV4((b) + 12)
+#define VC_REV64(b) VC_REV16(b), VC_REV16((b) + 16), VC_REV16((b) + 32), VC_REV16((b) + 48)
+
+static const unsigned char vc_bit_reverse[256] = {
+    VC_REV64(0), VC_REV64(64), VC_REV64(128), VC_REV64(192)
+};
+
+// Função auxiliar para converter uma linha PBM (bits) em píxeis, um byte por passo
+static void vc_pbm_unpack_row(const unsigned char *src, unsigned char *dst, int width)
+{
+    int full = width / 8;
+    int rest = width % 8;
+    int i;
+    
+    for (i = 0; i < full; i++) memcpy(&dst[i * 8], vc_pbm_unpack[src[i]], 8);
+    if (rest > 0) memcpy(&dst[full * 8], vc_pbm_unpack[src[full]], rest);
+}
+
+// Função auxiliar para converter uma linha de píxeis em PBM (bits); os bits de enchimento ficam a 0
+static void vc_pbm_pack_row(const unsigned char *src, unsigned char *dst, int width)
+{
+    int full = width / 8;
+    int rest = width % 8;
+    int i = 0, k;
+    unsigned char byte;
+    
+#ifdef VC_SSE2
+    // 16 píxeis por passo: máscara dos píxeis a 0 (preto), com a ordem dos bits invertida
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 2 <= full; i += 2)
+    {
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) &src[i * 8]), zero));
+        dst[i] = vc_bit_reverse[mask & 0xFF];
+        dst[i + 1] = vc_bit_reverse[mask >> 8];
+    }
+#endif
+    
+    for (; i < full; i++)
+    {
+        const unsigned char *p = &src[i * 8];
+        dst[i] = (unsigned char) (((p[0] == 0) << 7) | ((p[1] == 0) << 6) | ((p[2] == 0) << 5) | ((p[3] == 0) << 4) |
+                                  ((p[4] == 0) << 3) | ((p[5] == 0) << 2) | ((p[6] == 0) << 1) | (p[7] == 0));
+    }
+    
+    if (rest > 0)
+    {
+        byte = 0;
+        for (k = 0; k < rest; k++) byte |= (unsigned char) ((src[full * 8 + k] == 0) << (7 - k));
+        dst[full] = byte;
+    }
+}
+
 // Função para alocar memória para uma nova imagem
 IVC* vc_image_new(int width, int height, int channels, int levels)
 {
@@ -91,7 +187,7 @@ IVC* vc_read_image(char* filename)
     char tok[20];
     int channels, levels;
     int width, height;
-    int i, v;
+    int i;
     
     // Abre o arquivo para leitura em modo binário
     if ((file = fopen(filename, "rb")) != NULL)
@@ -105,7 +201,7 @@ IVC* vc_read_image(char* filename)
         else
         {
 #ifdef VC_DEBUG
-            printf("ERROR -> vc_read_image():\n\tFile format is not supported!\n");
+            vc_log(VC_LOG_ERRO, "ERROR -> vc_read_image():\n\tFile format is not supported!\n");
 #endif
             fclose(file);
             return NULL;
@@ -115,7 +211,7 @@ IVC* vc_read_image(char* filename)
         if (sscanf(netpbm_get_token(file, tok, sizeof(tok)), "%d", &width) != 1)
         {
 #ifdef VC_DEBUG
-            printf("ERROR -> vc_read_image():\n\tInvalid width!\n");
+            vc_log(VC_LOG_ERRO, "ERROR -> vc_read_image():\n\tInvalid width!\n");
 #endif
             fclose(file);
             return NULL;
@@ -125,7 +221,7 @@ IVC* vc_read_image(char* filename)
         if (sscanf(netpbm_get_token(file, tok, sizeof(tok)), "%d", &height) != 1)
         {
 #ifdef VC_DEBUG
-            printf("ERROR -> vc_read_image():\n\tInvalid height!\n");
+            vc_log(VC_LOG_ERRO, "ERROR -> vc_read_image():\n\tInvalid height!\n");
 #endif
             fclose(file);
             return NULL;
@@ -137,7 +233,7 @@ IVC* vc_read_image(char* filename)
             if (sscanf(netpbm_get_token(file, tok, sizeof(tok)), "%d", &levels) != 1)
             {
 #ifdef VC_DEBUG
-                printf("ERROR -> vc_read_image():\n\tInvalid maximum intensity level!\n");
+                vc_log(VC_LOG_ERRO, "ERROR -> vc_read_image():\n\tInvalid maximum intensity level!\n");
 #endif
                 fclose(file);
                 return NULL;
@@ -149,7 +245,7 @@ IVC* vc_read_image(char* filename)
         if (image == NULL)
         {
 #ifdef VC_DEBUG
-            printf("ERROR -> vc_read_image():\n\tOut of memory!\n");
+            vc_log(VC_LOG_ERRO, "ERROR -> vc_read_image():\n\tOut of memory!\n");
 #endif
             fclose(file);
             return NULL;
@@ -158,41 +254,33 @@ IVC* vc_read_image(char* filename)
         // Lê os dados da imagem
         if (levels == 1)
         {
-            // Imagem binária (PBM)
+            // Imagem binária (PBM): todos os dados de uma vez, convertidos um byte (8 píxeis) por passo
             int bytesperline = (image->width + 7) / 8;
-            tmp = (unsigned char *) malloc(bytesperline);
+            tmp = (unsigned char *) malloc(bytesperline * image->height);
             if (tmp == NULL)
             {
 #ifdef VC_DEBUG
-                printf("ERROR -> vc_read_image():\n\tOut of memory!\n");
+                vc_log(VC_LOG_ERRO, "ERROR -> vc_read_image():\n\tOut of memory!\n");
 #endif
                 fclose(file);
                 vc_image_free(image);
                 return NULL;
             }
             
-            for (i = 0; i < image->height; i++)
+            if (fread(tmp, bytesperline, image->height, file) != (size_t) image->height)
             {
-                if (fread(tmp, 1, bytesperline, file) != bytesperline)
-                {
 #ifdef VC_DEBUG
-                    printf("ERROR -> vc_read_image():\n\tError reading PBM file!\n");
+                vc_log(VC_LOG_ERRO, "ERROR -> vc_read_image():\n\tError reading PBM file!\n");
 #endif
-                    fclose(file);
-                    free(tmp);
-                    vc_image_free(image);
-                    return NULL;
-                }
-                
-                for (v = 0; v < image->width; v++)
-                {
-                    if (tmp[v / 8] & (1 << (7 - v % 8)))
-                        image->data[v + i * image->bytesperline] = 0;
-                    else
-                        image->data[v + i * image->bytesperline] = 1;
-                }
+                fclose(file);
+                free(tmp);
+                vc_image_free(image);
+                return NULL;
             }
             
+            for (i = 0; i < image->height; i++)
+                vc_pbm_unpack_row(&tmp[i * bytesperline], &image->data[i * image->bytesperline], image->width);
+            
             free(tmp);
         }
         else
@@ -201,7 +289,7 @@ IVC* vc_read_image(char* filename)
             if (fread(image->data, image->bytesperline, image->height, file) != image->height)
             {
 #ifdef VC_DEBUG
-                printf("ERROR -> vc_read_image():\n\tError reading PGM/PPM file!\n");
+                vc_log(VC_LOG_ERRO, "ERROR -> vc_read_image():\n\tError reading PGM/PPM file!\n");
 #endif
                 fclose(file);
                 vc_image_free(image);
@@ -214,7 +302,7 @@ IVC* vc_read_image(char* filename)
     }
     
 #ifdef VC_DEBUG
-    printf("ERROR -> vc_read_image():\n\tFile not found!\n");
+    vc_log(VC_LOG_ERRO, "ERROR -> vc_read_image():\n\tFile not found!\n");
 #endif
     return NULL;
 }
@@ -224,7 +312,7 @@ int vc_write_image(char* filename, IVC* image)
 {
     FILE *file = NULL;
     unsigned char *tmp;
-    int i, v;
+    int i;
     int bytesperline;
     int sizeofbinarydata;
     
@@ -245,30 +333,22 @@ int vc_write_image(char* filename, IVC* image)
             if (tmp == NULL)
             {
 #ifdef VC_DEBUG
-                printf("ERROR -> vc_write_image():\n\tOut of memory!\n");
+                vc_log(VC_LOG_ERRO, "ERROR -> vc_write_image():\n\tOut of memory!\n");
 #endif
                 fclose(file);
                 return 0;
             }
             
-            // Converte os dados para o formato PBM
+            // Converte os dados para o formato PBM (cada byte de saída é escrito por inteiro)
             bytesperline = (image->width + 7) / 8;
             for (i = 0; i < image->height; i++)
-            {
-                for (v = 0; v < image->width; v++)
-                {
-                    if (image->data[v + i * image->bytesperline] == 0)
-                        tmp[v / 8 + i * bytesperline] |= (1 << (7 - v % 8));
-                    else
-                        tmp[v / 8 + i * bytesperline] &= ~(1 << (7 - v % 8));
-                }
-            }
+                vc_pbm_pack_row(&image->data[i * image->bytesperline], &tmp[i * bytesperline], image->width);
             
             // Escreve os dados no arquivo
             if (fwrite(tmp, bytesperline, image->height, file) != image->height)
             {
 #ifdef VC_DEBUG
-                printf("ERROR -> vc_write_image():\n\tError writing PBM file!\n");
+                vc_log(VC_LOG_ERRO, "ERROR -> vc_write_image():\n\tError writing PBM file!\n");
 #endif
                 fclose(file);
                 free(tmp);
@@ -289,7 +369,7 @@ int vc_write_image(char* filename, IVC* image)
             if (fwrite(image->data, image->bytesperline, image->height, file) != image->height)
             {
 #ifdef VC_DEBUG
-                printf("ERROR -> vc_write_image():\n\tError writing PGM/PPM file!\n");
+                vc_log(VC_LOG_ERRO, "ERROR -> vc_write_image():\n\tError writing PGM/PPM file!\n");
 #endif
                 fclose(file);
                 return 0;
@@ -301,194 +381,2596 @@ int vc_write_image(char* filename, IVC* image)
     }
     
 #ifdef VC_DEBUG
-    printf("ERROR -> vc_write_image():\n\tFile not opened for writing!\n");
+    vc_log(VC_LOG_ERRO, "ERROR -> vc_write_image():\n\tFile not opened for writing!\n");
 #endif
     return 0;
 }
 
+// Função para mapear um ficheiro em memória (só leitura; as escritas ficam numa cópia privada)
+// Devolve o endereço do mapeamento e o seu tamanho em *length, ou NULL em caso de erro
+void* vc_file_map(const char* filename, size_t* length)
+{
+    void *base = NULL;
+    
+    if ((filename == NULL) || (length == NULL)) return NULL;
+    *length = 0;
+    
+#ifdef _WIN32
+    HANDLE file, mapping;
+    LARGE_INTEGER size;
+    
+    // Leitura sequencial: o sistema antecipa as páginas seguintes
+    file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+    
+    if (!GetFileSizeEx(file, &size) || (size.QuadPart <= 0))
+    {
+        CloseHandle(file);
+        return NULL;
+    }
+    
+    mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    if (mapping != NULL)
+    {
+        base = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+    
+    if (base == NULL) return NULL;
+    *length = (size_t) size.QuadPart;
+#else
+    struct stat st;
+    int fd = open(filename, O_RDONLY);
+    
+    if (fd < 0) return NULL;
+    
+    if ((fstat(fd, &st) != 0) || (st.st_size <= 0))
+    {
+        close(fd);
+        return NULL;
+    }
+    
+    // MAP_PRIVATE: a imagem pode ser alterada no lugar sem modificar o ficheiro
+    base = mmap(NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    
+    if (base == MAP_FAILED) return NULL;
+    
+    // Leitura sequencial: o kernel antecipa as páginas seguintes
+    madvise(base, (size_t) st.st_size, MADV_SEQUENTIAL);
+    *length = (size_t) st.st_size;
+#endif
+    
+    return base;
+}
 
+// Função para desfazer o mapeamento criado por vc_file_map()
+void vc_file_unmap(void* base, size_t length)
+{
+    if (base == NULL) return;
+    
+#ifdef _WIN32
+    (void) length;
+    UnmapViewOfFile(base);
+#else
+    munmap(base, length);
+#endif
+}
 
+// Imagem cujos dados apontam para um ficheiro mapeado (a IVC tem de ser o primeiro membro)
+typedef struct {
+    IVC image;
+    void *base;
+    size_t length;
+} vc_mapped_image;
 
-int vc_rgb_to_gray(IVC *src, IVC *dst)
+// Função auxiliar para ler um token do cabeçalho NetPBM a partir da memória
+static int netpbm_get_token_mem(const unsigned char *buf, size_t length, size_t *pos, char *tok, int len)
 {
-    if ((src == NULL) || (dst == NULL)) return 0;
-    if ((src->width != dst->width) || (src->height != dst->height) || (src->channels != 3) || (dst->channels != 1)) return 0;
-
-    for (int y = 0; y < src->height; y++)
+    size_t p = *pos;
+    int n = 0;
+    
+    for (;;)
     {
-        for (int x = 0; x < src->width; x++)
-        {
-            int pos_src = y * src->bytesperline + x * src->channels;
-            int pos_dst = y * dst->bytesperline + x;
-
-            unsigned char r = src->data[pos_src];
-            unsigned char g = src->data[pos_src + 1];
-            unsigned char b = src->data[pos_src + 2];
-
-            dst->data[pos_dst] = (unsigned char)((r * 0.299) + (g * 0.587) + (b * 0.114));
-        }
+        while ((p < length) && isspace(buf[p])) p++;
+        
+        if ((p >= length) || (buf[p] != '#')) break;
+        
+        while ((p < length) && (buf[p] != '\n')) p++;
     }
+    
+    while ((p < length) && !isspace(buf[p]) && (buf[p] != '#') && (n < len - 1))
+        tok[n++] = (char) buf[p++];
+    tok[n] = 0;
+    
+    *pos = p;
+    return n;
+}
 
-    return 1;
+// Função para ler uma imagem PGM (P5) ou PPM (P6) sem cópia: os dados da IVC apontam para o ficheiro mapeado
+// A imagem devolvida tem de ser libertada com vc_image_unmap() (e não com vc_image_free())
+IVC* vc_read_image_mapped(char* filename)
+{
+    vc_mapped_image *mapped;
+    unsigned char *base;
+    size_t length, pos = 0, size;
+    char tok[20];
+    int channels, width, height, levels;
+    
+    base = (unsigned char *) vc_file_map(filename, &length);
+    if (base == NULL)
+    {
+#ifdef VC_DEBUG
+        vc_log(VC_LOG_ERRO, "ERROR -> vc_read_image_mapped():\n\tFile not found!\n");
+#endif
+        return NULL;
+    }
+    
+    // Lê o tipo de arquivo (o P4 guarda 8 píxeis por byte e não pode ser lido sem conversão)
+    netpbm_get_token_mem(base, length, &pos, tok, sizeof(tok));
+    
+    if (strcmp(tok, "P5") == 0) channels = 1;
+    else if (strcmp(tok, "P6") == 0) channels = 3;
+    else
+    {
+#ifdef VC_DEBUG
+        vc_log(VC_LOG_ERRO, "ERROR -> vc_read_image_mapped():\n\tFile format is not supported!\n");
+#endif
+        vc_file_unmap(base, length);
+        return NULL;
+    }
+    
+    // Lê a largura, a altura e o valor máximo de intensidade
+    if ((netpbm_get_token_mem(base, length, &pos, tok, sizeof(tok)) == 0) || (sscanf(tok, "%d", &width) != 1) ||
+        (netpbm_get_token_mem(base, length, &pos, tok, sizeof(tok)) == 0) || (sscanf(tok, "%d", &height) != 1) ||
+        (netpbm_get_token_mem(base, length, &pos, tok, sizeof(tok)) == 0) || (sscanf(tok, "%d", &levels) != 1) ||
+        (width <= 0) || (height <= 0) || (levels <= 0) || (levels > 255))
+    {
+#ifdef VC_DEBUG
+        vc_log(VC_LOG_ERRO, "ERROR -> vc_read_image_mapped():\n\tInvalid header!\n");
+#endif
+        vc_file_unmap(base, length);
+        return NULL;
+    }
+    
+    // Um único espaço separa o cabeçalho dos dados
+    pos++;
+    
+    size = (size_t) width * (size_t) height * (size_t) channels;
+    if ((pos > length) || (size > length - pos))
+    {
+#ifdef VC_DEBUG
+        vc_log(VC_LOG_ERRO, "ERROR -> vc_read_image_mapped():\n\tError reading PGM/PPM file!\n");
+#endif
+        vc_file_unmap(base, length);
+        return NULL;
+    }
+    
+    mapped = (vc_mapped_image *) malloc(sizeof(vc_mapped_image));
+    if (mapped == NULL)
+    {
+#ifdef VC_DEBUG
+        vc_log(VC_LOG_ERRO, "ERROR -> vc_read_image_mapped():\n\tOut of memory!\n");
+#endif
+        vc_file_unmap(base, length);
+        return NULL;
+    }
+    
+    mapped->image.data = base + pos;
+    mapped->image.width = width;
+    mapped->image.height = height;
+    mapped->image.channels = channels;
+    mapped->image.levels = levels;
+    mapped->image.bytesperline = width * channels;
+    mapped->base = base;
+    mapped->length = length;
+    
+    return &mapped->image;
 }
 
-int vc_gray_to_binary_global_mean(IVC *src, IVC *dst)
+// Função para libertar uma imagem lida com vc_read_image_mapped()
+IVC* vc_image_unmap(IVC* image)
 {
-    if ((src == NULL) || (dst == NULL)) return 0;
-    if ((src->width != dst->width) || (src->height != dst->height) || (src->channels != 1) || (dst->channels != 1)) return 0;
+    vc_mapped_image *mapped = (vc_mapped_image *) image;
+    
+    if (mapped != NULL)
+    {
+        vc_file_unmap(mapped->base, mapped->length);
+        free(mapped);
+    }
+    
+    return NULL;
+}
 
-    long sum = 0;
-    int total = src->width * src->height;
 
-    for (int i = 0; i < total; i++)
-        sum += src->data[i];
 
-    /* int threshold = sum / total; */
-    int threshold = (sum / total) - 30;
 
-    for (int i = 0; i < total; i++)
-        dst->data[i] = (src->data[i] >= threshold) ? 255 : 0;
+//++++ DESPACHO POR CPU ++++
+// Os kernels mais usados são compilados em várias variantes (base, SSE4.1, AVX2, AVX-512) a partir
+// do mesmo corpo, que o compilador vetoriza para cada conjunto de instruções (o CMakeLists.txt
+// compila este ficheiro com -O3: abaixo disso o GCC não vetoriza). A variante é
+// escolhida uma vez, no arranque, pelo CPUID (ou pela variável de ambiente VC_CPU).
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define VC_DISPATCH
+#define VC_TARGET(t) __attribute__((target(t)))
+#define VC_BODY static inline __attribute__((always_inline))
+#else
+#define VC_BODY static inline
+#endif
 
-    return 1;
+// Corpo: conversão de uma linha RGB em cinzento (vírgula fixa, 16 bits de fração)
+VC_BODY void vc_gray_row_body(const unsigned char *src, unsigned char *dst, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        unsigned int r = src[3 * i], g = src[3 * i + 1], b = src[3 * i + 2];
+        dst[i] = (unsigned char) ((r * 19595u + g * 38470u + b * 7471u) >> 16);
+    }
 }
 
-int vc_binary_dilate(IVC *src, IVC *dst, int kernel_size)
+// Corpo: uma linha do filtro gaussiano 5x5 (pesos inteiros, soma 273), para x em [x0, x1)
+// As somas são inteiros exatos, logo o resultado é igual ao da soma em float original
+VC_BODY void vc_blur5_row_body(const unsigned char *p, int bytesperline, unsigned char *dst, int x0, int x1)
 {
-    if (!src || !dst || kernel_size <= 0) return 0;
-
-    int offset = kernel_size / 2;
+    const unsigned char *r0 = p, *r1 = p + bytesperline, *r2 = r1 + bytesperline;
+    const unsigned char *r3 = r2 + bytesperline, *r4 = r3 + bytesperline;
+    
+    for (int x = x0; x < x1; x++)
+    {
+        int s = (r0[x - 2] + r0[x + 2] + r4[x - 2] + r4[x + 2])
+              + 4 * (r0[x - 1] + r0[x + 1] + r1[x - 2] + r1[x + 2] + r3[x - 2] + r3[x + 2] + r4[x - 1] + r4[x + 1])
+              + 7 * (r0[x] + r2[x - 2] + r2[x + 2] + r4[x])
+              + 16 * (r1[x - 1] + r1[x + 1] + r3[x - 1] + r3[x + 1])
+              + 26 * (r1[x] + r2[x - 1] + r2[x + 1] + r3[x])
+              + 41 * r2[x];
+        dst[x] = (unsigned char) ((float) s / 273.0f);
+    }
+}
 
-    for (int y = 0; y < src->height; y++)
+// Corpo: somas e somas dos quadrados de blocos de 16 píxeis de 3 canais (48 bytes), por posição no bloco
+// A posição j do bloco pertence ao canal j % 3; cada soma de quadrados de 32 bits aguenta 66051 blocos
+VC_BODY void vc_color_sum48_body(const unsigned char *p, int nblocks, unsigned int *sum, unsigned int *sq)
+{
+    // Somas em cópias locais: sem aliasing com p, o ciclo interior é vetorizado
+    unsigned int s[48], q[48];
+    
+    memcpy(s, sum, sizeof(s));
+    memcpy(q, sq, sizeof(q));
+    for (int b = 0; b < nblocks; b++, p += 48)
     {
-        for (int x = 0; x < src->width; x++)
+        for (int j = 0; j < 48; j++)
         {
-            int found_white = 0;
-
-            for (int ky = -offset; ky <= offset; ky++)
-            {
-                for (int kx = -offset; kx <= offset; kx++)
-                {
-                    int nx = x + kx;
-                    int ny = y + ky;
-
-                    if (nx >= 0 && nx < src->width && ny >= 0 && ny < src->height)
-                    {
-                        if (src->data[ny * src->bytesperline + nx] == 255)
-                        {
-                            found_white = 1;
-                            break;
-                        }
-                    }
-                }
-                if (found_white) break;
-            }
-
-            dst->data[y * dst->bytesperline + x] = found_white ? 255 : 0;
+            unsigned int v = p[j];
+            s[j] += v;
+            q[j] += v * v;
         }
     }
-
-    return 1;
+    memcpy(sum, s, sizeof(s));
+    memcpy(sq, q, sizeof(q));
 }
 
-int vc_binary_erode(IVC *src, IVC *dst, int kernel_size)
+// Corpo: somas HSV de n píxeis BGR (S e V em 0..255, matiz em graus inteiros), sem saltos
+// sums: matiz como vetor (cos, sin em vírgula fixa Q14) pesado pela saturação, S, S², V, V²
+// As divisões em float truncadas dão o mesmo que as inteiras (quocientes de inteiros até 65025)
+VC_BODY void vc_hsv_sums_body(const unsigned char *p, int n, const int *hue_cos, const int *hue_sin, long long *sums)
 {
-    if (!src || !dst || kernel_size <= 0) return 0;
+    long long hc = 0, hs = 0, s = 0, s2 = 0, v = 0, v2 = 0;
+    
+    for (int i = 0; i < n; i++)
+    {
+        int b = p[3 * i], g = p[3 * i + 1], r = p[3 * i + 2];
+        int max = (r > g) ? r : g, min = (r < g) ? r : g;
+        max = (max > b) ? max : b;
+        min = (min < b) ? min : b;
+        int delta = max - min;
+        int sat = (int) ((float) (delta * 255) / (float) (max + (max == 0)));
+        
+        // Máscaras em vez de condições; com delta = 0 a saturação é 0 e a matiz não conta
+        int isr = -(max == r), isg = -(max == g) & ~isr, isb = ~(isr | isg);
+        int num = (isr & (g - b)) | (isg & (b - r)) | (isb & (r - g));
+        int h = (isg & 120) + (isb & 240) + (int) ((float) (num * 60) / (float) (delta + (delta == 0)));
+        h += (h >> 31) & 360;
+        
+        hc += sat * hue_cos[h];
+        hs += sat * hue_sin[h];
+        s += sat;
+        s2 += sat * sat;
+        v += max;
+        v2 += max * max;
+    }
+    sums[0] += hc;
+    sums[1] += hs;
+    sums[2] += s;
+    sums[3] += s2;
+    sums[4] += v;
+    sums[5] += v2;
+}
 
-    int offset = kernel_size / 2;
+// Variantes de cada corpo: nome_scalar (compilação base), nome_sse41, nome_avx2 e nome_avx512
+#ifdef VC_DISPATCH
+#define VC_VARIANTS(nome, params, args) \
+    static void nome##_scalar params { nome##_body args; } \
+    VC_TARGET("sse4.1") static void nome##_sse41 params { nome##_body args; } \
+    VC_TARGET("avx2") static void nome##_avx2 params { nome##_body args; } \
+    VC_TARGET("avx512f,avx512bw") static void nome##_avx512 params { nome##_body args; }
+#else
+#define VC_VARIANTS(nome, params, args) \
+    static void nome##_scalar params { nome##_body args; }
+#endif
 
-    for (int y = 0; y < src->height; y++)
-    {
-        for (int x = 0; x < src->width; x++)
-        {
-            int all_white = 1;
+VC_VARIANTS(vc_gray_row, (const unsigned char *src, unsigned char *dst, int n), (src, dst, n))
+VC_VARIANTS(vc_blur5_row, (const unsigned char *p, int bytesperline, unsigned char *dst, int x0, int x1), (p, bytesperline, dst, x0, x1))
+VC_VARIANTS(vc_color_sum48, (const unsigned char *p, int nblocks, unsigned int *sum, unsigned int *sq), (p, nblocks, sum, sq))
+VC_VARIANTS(vc_hsv_sums, (const unsigned char *p, int n, const int *hue_cos, const int *hue_sin, long long *sums), (p, n, hue_cos, hue_sin, sums))
 
-            for (int ky = -offset; ky <= offset; ky++)
-            {
-                for (int kx = -offset; kx <= offset; kx++)
-                {
-                    int nx = x + kx;
-                    int ny = y + ky;
+// Tabela das variantes em uso
+static struct {
+    int level;
+    void (*gray_row)(const unsigned char *src, unsigned char *dst, int n);
+    void (*blur5_row)(const unsigned char *p, int bytesperline, unsigned char *dst, int x0, int x1);
+    void (*color_sum48)(const unsigned char *p, int nblocks, unsigned int *sum, unsigned int *sq);
+    void (*hsv_sums)(const unsigned char *p, int n, const int *hue_cos, const int *hue_sin, long long *sums);
+} vc_kernels = { -1, vc_gray_row_scalar, vc_blur5_row_scalar, vc_color_sum48_scalar, vc_hsv_sums_scalar };
 
-                    if (nx >= 0 && nx < src->width && ny >= 0 && ny < src->height)
-                    {
-                        if (src->data[ny * src->bytesperline + nx] != 255)
-                        {
-                            all_white = 0;
-                            break;
-                        }
-                    }
-                }
-                if (!all_white) break;
-            }
+// Cosseno e seno de cada grau de matiz, em vírgula fixa Q14 (preenchidos com a tabela, em vc_cpu_init)
+static int vc_hue_cos[360], vc_hue_sin[360];
 
-            dst->data[y * dst->bytesperline + x] = all_white ? 255 : 0;
-        }
-    }
+static const char *vc_cpu_names[] = { "scalar", "sse41", "avx2", "avx512" };
 
-    return 1;
+// Nome de um nível (também o valor aceite em VC_CPU)
+const char* vc_cpu_level_name(int level)
+{
+    return ((level >= VC_CPU_SCALAR) && (level <= VC_CPU_AVX512)) ? vc_cpu_names[level] : "?";
 }
 
-int vc_gray_to_binary_adaptive_mean(IVC *src, IVC *dst, int windowSize, int offset)
+// Função para detetar o CPU e escolher as variantes dos kernels; devolve o nível escolhido
+// Deve ser chamada no arranque, antes de criar threads (depois disso a tabela só é lida)
+int vc_cpu_init(void)
 {
-    int halfWindow = windowSize / 2;
-
-    if ((src == NULL) || (dst == NULL)) return 0;
-    if ((src->width != dst->width) || (src->height != dst->height) || (src->channels != 1) || (dst->channels != 1)) return 0;
-
-    for (int y = halfWindow; y < src->height - halfWindow; y++)
+    int detected = VC_CPU_SCALAR;
+    int level;
+    const char *env;
+    
+#ifdef VC_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.1")) detected = VC_CPU_SSE41;
+    if (__builtin_cpu_supports("avx2")) detected = VC_CPU_AVX2;
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) detected = VC_CPU_AVX512;
+#endif
+    level = detected;
+    
+    // Nível forçado (testes): VC_CPU=scalar|sse41|avx2|avx512; nunca acima do que o CPU suporta
+    env = getenv("VC_CPU");
+    if (env != NULL)
     {
-        for (int x = halfWindow; x < src->width - halfWindow; x++)
-        {
-            int sum = 0;
-            for (int wy = -halfWindow; wy <= halfWindow; wy++)
-            {
-                for (int wx = -halfWindow; wx <= halfWindow; wx++)
-                {
-                    sum += src->data[(y + wy) * src->bytesperline + (x + wx)];
-                }
-            }
-            int area = windowSize * windowSize;
-            int localMean = sum / area;
-
-            int pixel = src->data[y * src->bytesperline + x];
-            dst->data[y * dst->bytesperline + x] = (pixel < (localMean - offset)) ? 0 : 255;
-        }
+        int forced = -1;
+        for (int i = VC_CPU_SCALAR; i <= VC_CPU_AVX512; i++)
+            if (strcmp(env, vc_cpu_names[i]) == 0) forced = i;
+        
+        if (forced < 0)
+            vc_log(VC_LOG_AVISO, "VC_CPU='%s' desconhecido (scalar, sse41, avx2 ou avx512): ignorado.\n", env);
+        else if (forced > detected)
+            vc_log(VC_LOG_AVISO, "VC_CPU=%s não é suportado por este CPU: a usar %s.\n", env, vc_cpu_names[detected]);
+        else
+            level = forced;
+    }
+    
+    vc_kernels.gray_row = vc_gray_row_scalar;
+    vc_kernels.blur5_row = vc_blur5_row_scalar;
+    vc_kernels.color_sum48 = vc_color_sum48_scalar;
+    vc_kernels.hsv_sums = vc_hsv_sums_scalar;
+#ifdef VC_DISPATCH
+    if (level == VC_CPU_SSE41)
+    {
+        vc_kernels.gray_row = vc_gray_row_sse41;
+        vc_kernels.blur5_row = vc_blur5_row_sse41;
+        vc_kernels.color_sum48 = vc_color_sum48_sse41;
+        vc_kernels.hsv_sums = vc_hsv_sums_sse41;
+    }
+    else if (level == VC_CPU_AVX2)
+    {
+        vc_kernels.gray_row = vc_gray_row_avx2;
+        vc_kernels.blur5_row = vc_blur5_row_avx2;
+        vc_kernels.color_sum48 = vc_color_sum48_avx2;
+        vc_kernels.hsv_sums = vc_hsv_sums_avx2;
+    }
+    else if (level == VC_CPU_AVX512)
+    {
+        vc_kernels.gray_row = vc_gray_row_avx512;
+        vc_kernels.blur5_row = vc_blur5_row_avx512;
+        vc_kernels.color_sum48 = vc_color_sum48_avx512;
+        vc_kernels.hsv_sums = vc_hsv_sums_avx512;
+    }
+#endif
+    for (int h = 0; h < 360; h++)
+    {
+        vc_hue_cos[h] = (int) lround(16384.0 * cos(h * 3.14159265358979323846 / 180.0));
+        vc_hue_sin[h] = (int) lround(16384.0 * sin(h * 3.14159265358979323846 / 180.0));
     }
+    vc_kernels.level = level;
+    
+    return level;
+}
 
-    return 1;
+// Função para obter o nível em uso (deteta na primeira chamada)
+int vc_cpu_level(void)
+{
+    if (vc_kernels.level < 0) vc_cpu_init();
+    return vc_kernels.level;
 }
 
+//++++ PARALELISMO ++++
 
-int vc_gray_gaussian_blur(IVC *src, IVC *dst)
+static int vc_num_threads = 1;
+
+// Função para definir o número de threads das funções que dividem a imagem em faixas (1 = sem threads)
+void vc_threads_set(int n)
+{
+#ifdef _OPENMP
+    if (n < 1) n = omp_get_num_procs();
+    vc_num_threads = n;
+#else
+    (void) n;
+    vc_num_threads = 1;
+#endif
+}
+
+int vc_threads_get(void)
+{
+    return vc_num_threads;
+}
+
+// Função para converter uma imagem RGB em cinzento (0.299 R + 0.587 G + 0.114 B, em vírgula fixa)
+int vc_rgb_to_gray(IVC *src, IVC *dst)
+{
+    if ((src == NULL) || (dst == NULL)) return 0;
+    if ((src->width != dst->width) || (src->height != dst->height) || (src->channels != 3) || (dst->channels != 1)) return 0;
+    if (vc_kernels.level < 0) vc_cpu_init();
+
+    for (int y = 0; y < src->height; y++)
+        vc_kernels.gray_row(&src->data[y * src->bytesperline], &dst->data[y * dst->bytesperline], src->width);
+
+    return 1;
+}
+
+//++++ HISTOGRAMA E LIMIARES GLOBAIS ++++
+
+// Função para acumular o histograma de uma linha em 4 sub-histogramas: píxeis seguidos com o mesmo
+// valor incrementam contadores diferentes, sem esperar pela escrita anterior na mesma posição
+static void vc_histogram_row(const unsigned char *p, int width, unsigned int sub[4][256])
+{
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8)
+    {
+        uint64_t v;
+        memcpy(&v, &p[x], 8);
+        sub[0][v & 0xff]++;
+        sub[1][(v >> 8) & 0xff]++;
+        sub[2][(v >> 16) & 0xff]++;
+        sub[3][(v >> 24) & 0xff]++;
+        sub[0][(v >> 32) & 0xff]++;
+        sub[1][(v >> 40) & 0xff]++;
+        sub[2][(v >> 48) & 0xff]++;
+        sub[3][v >> 56]++;
+    }
+    for (; x < width; x++) sub[0][p[x]]++;
+}
+
+// Função para juntar os sub-histogramas num histograma
+static void vc_histogram_merge(unsigned int sub[4][256], unsigned int *hist)
+{
+    for (int i = 0; i < 256; i++) hist[i] += sub[0][i] + sub[1][i] + sub[2][i] + sub[3][i];
+}
+
+// Função para calcular o histograma de uma imagem em cinzento (hist[256]); com vc_threads_set(n > 1)
+// e OpenMP, cada thread conta uma faixa de linhas e os histogramas são somados no fim
+int vc_gray_histogram(IVC *src, unsigned int *hist)
+{
+    if ((src == NULL) || (hist == NULL) || (src->channels != 1)) return 0;
+
+    memset(hist, 0, 256 * sizeof(unsigned int));
+
+#ifdef _OPENMP
+    int nthreads = (src->height >= 64) ? vc_num_threads : 1;
+    #pragma omp parallel num_threads(nthreads) if (nthreads > 1)
+#endif
+    {
+        unsigned int sub[4][256];
+        memset(sub, 0, sizeof(sub));
+
+#ifdef _OPENMP
+        #pragma omp for schedule(static)
+#endif
+        for (int y = 0; y < src->height; y++)
+            vc_histogram_row(&src->data[y * src->bytesperline], src->width, sub);
+
+#ifdef _OPENMP
+        #pragma omp critical
+#endif
+        vc_histogram_merge(sub, hist);
+    }
+
+    return 1;
+}
+
+// Função para converter para cinzento e calcular o histograma na mesma passagem
+// (cada linha é contada enquanto ainda está na cache, sem voltar a ler a imagem)
+int vc_rgb_to_gray_histogram(IVC *src, IVC *dst, unsigned int *hist)
+{
+    if ((src == NULL) || (dst == NULL) || (hist == NULL)) return 0;
+    if ((src->width != dst->width) || (src->height != dst->height) || (src->channels != 3) || (dst->channels != 1)) return 0;
+    if (vc_kernels.level < 0) vc_cpu_init();
+
+    unsigned int sub[4][256];
+    memset(sub, 0, sizeof(sub));
+    memset(hist, 0, 256 * sizeof(unsigned int));
+
+    for (int y = 0; y < src->height; y++)
+    {
+        unsigned char *linha = &dst->data[y * dst->bytesperline];
+        vc_kernels.gray_row(&src->data[y * src->bytesperline], linha, src->width);
+        vc_histogram_row(linha, src->width, sub);
+    }
+    vc_histogram_merge(sub, hist);
+
+    return 1;
+}
+
+// Função para calcular o limiar de Otsu (máxima variância entre classes); devolve -1 se vazio
+int vc_histogram_otsu(const unsigned int *hist)
+{
+    if (hist == NULL) return -1;
+
+    double total = 0.0, soma = 0.0;
+    for (int i = 0; i < 256; i++)
+    {
+        total += hist[i];
+        soma += (double) i * hist[i];
+    }
+    if (total == 0.0) return -1;
+
+    double peso0 = 0.0, soma0 = 0.0, melhor = -1.0;
+    int limiar = -1;
+
+    for (int t = 0; t < 255; t++)
+    {
+        peso0 += hist[t];
+        soma0 += (double) t * hist[t];
+        if (peso0 == 0.0) continue;
+
+        double peso1 = total - peso0;
+        if (peso1 == 0.0) break;
+
+        double media0 = soma0 / peso0;
+        double media1 = (soma - soma0) / peso1;
+        double variancia = peso0 * peso1 * (media0 - media1) * (media0 - media1);
+        if (variancia > melhor)
+        {
+            melhor = variancia;
+            limiar = t;
+        }
+    }
+
+    // Um só nível de cinzento: a imagem inteira fica numa classe
+    if (limiar < 0)
+        for (limiar = 0; hist[limiar] == 0; limiar++);
+
+    return limiar;
+}
+
+// Função para obter o menor nível com pelo menos percent% dos píxeis até si; devolve -1 se vazio
+int vc_histogram_percentile(const unsigned int *hist, float percent)
 {
-    int kernelSize = 5;
-    int halfKernel = kernelSize / 2;
-    float gaussianKernel[5][5] = {
-        {1, 4, 7, 4, 1},
-        {4, 16, 26, 16, 4},
-        {7, 26, 41, 26, 7},
-        {4, 16, 26, 16, 4},
-        {1, 4, 7, 4, 1}
-    };
-    float sumKernel = 273.0f;
+    if ((hist == NULL) || (percent < 0.0f) || (percent > 100.0f)) return -1;
+
+    double total = 0.0;
+    for (int i = 0; i < 256; i++) total += hist[i];
+    if (total == 0.0) return -1;
+
+    double alvo = total * percent / 100.0, acumulado = 0.0;
+    for (int i = 0; i < 256; i++)
+    {
+        acumulado += hist[i];
+        if ((acumulado >= alvo) && (acumulado > 0.0)) return i;
+    }
+
+    return 255;
+}
 
+// Função para binarizar por um limiar fixo (píxeis > threshold ficam a 255); src pode ser igual a dst
+int vc_gray_to_binary(IVC *src, IVC *dst, int threshold)
+{
     if ((src == NULL) || (dst == NULL)) return 0;
     if ((src->width != dst->width) || (src->height != dst->height) || (src->channels != 1) || (dst->channels != 1)) return 0;
 
-    for (int y = halfKernel; y < src->height - halfKernel; y++)
+    for (int y = 0; y < src->height; y++)
+    {
+        const unsigned char *s = &src->data[y * src->bytesperline];
+        unsigned char *d = &dst->data[y * dst->bytesperline];
+        for (int x = 0; x < src->width; x++) d[x] = (s[x] > threshold) ? 255 : 0;
+    }
+
+    return 1;
+}
+
+// Função para binarizar pelo limiar de Otsu
+int vc_gray_to_binary_otsu(IVC *src, IVC *dst)
+{
+    unsigned int hist[256];
+
+    if (!vc_gray_histogram(src, hist)) return 0;
+
+    return vc_gray_to_binary(src, dst, vc_histogram_otsu(hist));
+}
+
+// Função para binarizar pela média global menos 30 (desvio original); a média vem do histograma
+int vc_gray_to_binary_global_mean(IVC *src, IVC *dst)
+{
+    unsigned int hist[256];
+
+    if ((src == NULL) || (dst == NULL)) return 0;
+    if (!vc_gray_histogram(src, hist)) return 0;
+
+    long long soma = 0, total = 0;
+    for (int i = 0; i < 256; i++)
+    {
+        soma += (long long) i * hist[i];
+        total += hist[i];
+    }
+    if (total == 0) return 0;
+
+    /* int threshold = sum / total; */
+    int threshold = (int) (soma / total) - 30;
+
+    // Píxeis >= threshold ficam a 255
+    return vc_gray_to_binary(src, dst, threshold - 1);
+}
+
+int vc_binary_dilate(IVC *src, IVC *dst, int kernel_size)
+{
+    if (!src || !dst || kernel_size <= 0) return 0;
+
+    int offset = kernel_size / 2;
+
+    for (int y = 0; y < src->height; y++)
+    {
+        for (int x = 0; x < src->width; x++)
+        {
+            int found_white = 0;
+
+            for (int ky = -offset; ky <= offset; ky++)
+            {
+                for (int kx = -offset; kx <= offset; kx++)
+                {
+                    int nx = x + kx;
+                    int ny = y + ky;
+
+                    if (nx >= 0 && nx < src->width && ny >= 0 && ny < src->height)
+                    {
+                        if (src->data[ny * src->bytesperline + nx] == 255)
+                        {
+                            found_white = 1;
+                            break;
+                        }
+                    }
+                }
+                if (found_white) break;
+            }
+
+            dst->data[y * dst->bytesperline + x] = found_white ? 255 : 0;
+        }
+    }
+
+    return 1;
+}
+
+int vc_binary_erode(IVC *src, IVC *dst, int kernel_size)
+{
+    if (!src || !dst || kernel_size <= 0) return 0;
+
+    int offset = kernel_size / 2;
+
+    for (int y = 0; y < src->height; y++)
     {
-        for (int x = halfKernel; x < src->width - halfKernel; x++)
+        for (int x = 0; x < src->width; x++)
         {
-            float sum = 0.0f;
-            for (int ky = -halfKernel; ky <= halfKernel; ky++)
+            int all_white = 1;
+
+            for (int ky = -offset; ky <= offset; ky++)
             {
-                for (int kx = -halfKernel; kx <= halfKernel; kx++)
+                for (int kx = -offset; kx <= offset; kx++)
                 {
-                    int pixel = src->data[(y + ky) * src->bytesperline + (x + kx)];
-                    sum += pixel * gaussianKernel[ky + halfKernel][kx + halfKernel];
+                    int nx = x + kx;
+                    int ny = y + ky;
+
+                    if (nx >= 0 && nx < src->width && ny >= 0 && ny < src->height)
+                    {
+                        if (src->data[ny * src->bytesperline + nx] != 255)
+                        {
+                            all_white = 0;
+                            break;
+                        }
+                    }
                 }
+                if (!all_white) break;
             }
-            dst->data[y * dst->bytesperline + x] = (unsigned char)(sum / sumKernel);
+
+            dst->data[y * dst->bytesperline + x] = all_white ? 255 : 0;
+        }
+    }
+
+    return 1;
+}
+
+//++++ FECHO E ABERTURA FUNDIDOS ++++
+// O elemento estruturante quadrado é separável: cada operação é uma passagem horizontal (contagem
+// deslizante de píxeis brancos na linha) seguida de uma vertical (contagem por coluna sobre as
+// últimas 2r+1 linhas, num anel). As duas operações são encadeadas linha a linha: a linha y do
+// destino só é escrita depois de lidas as linhas até y+2r da origem, que nunca voltam a ser lidas,
+// pelo que src == dst é seguro. A origem é lida e o destino escrito uma única vez.
+
+// Estado de uma operação (dilatação ou erosão) sobre um fluxo de linhas
+typedef struct {
+    int r, k, width, height;
+    int dilatar;
+    unsigned char *anel;            // k linhas do resultado horizontal (0/1)
+    int *soma;                      // Soma vertical por coluna das linhas do anel na janela
+    int linhas;                     // Linhas de entrada já acrescentadas
+} vc_morph_fase;
+
+// Função para aplicar a passagem horizontal a uma linha (vizinhos fora da imagem são ignorados)
+static void vc_morph_horizontal(const unsigned char *in, unsigned char *out, int width, int r, int dilatar)
+{
+    // Raios pequenos: no interior, um OU/E por deslocamento sobre a linha inteira (vetorizável)
+    int interior = (r <= 8) && (width > 2 * r);
+    if (interior)
+    {
+        for (int x = r; x < width - r; x++) out[x] = (in[x - r] == 255);
+        for (int d = -r + 1; d <= r; d++)
+        {
+            if (dilatar)
+                for (int x = r; x < width - r; x++) out[x] |= (in[x + d] == 255);
+            else
+                for (int x = r; x < width - r; x++) out[x] &= (in[x + d] == 255);
+        }
+    }
+
+    // Margens (ou a linha toda): contagem deslizante de píxeis brancos na janela
+    int count = 0;
+    for (int x = 0; x < r && x < width; x++) count += (in[x] == 255);
+
+    for (int x = 0; x < width; x++)
+    {
+        if (x + r < width) count += (in[x + r] == 255);
+        if (x - r - 1 >= 0) count -= (in[x - r - 1] == 255);
+
+        if (interior && x == r)
+        {
+            // Saltar o interior, repondo a contagem para a margem direita
+            x = width - r - 1;
+            count = 0;
+            for (int i = x - r; i <= x + r; i++) count += (in[i] == 255);
+            continue;
+        }
+
+        int n = ((x + r < width) ? x + r : width - 1) - ((x - r > 0) ? x - r : 0) + 1;
+        out[x] = dilatar ? (count > 0) : (count == n);
+    }
+}
+
+// Função para acrescentar uma linha de entrada à fase
+static void vc_morph_acrescentar(vc_morph_fase *f, const unsigned char *linha)
+{
+    unsigned char *h = &f->anel[(f->linhas % f->k) * f->width];
+
+    vc_morph_horizontal(linha, h, f->width, f->r, f->dilatar);
+    for (int x = 0; x < f->width; x++) f->soma[x] += h[x];
+    f->linhas++;
+}
+
+// Função para obter a linha de saída o (0/255); pede as linhas de entrada que faltam a obter(),
+// que devolve a linha y (da imagem ou escrita em tmp)
+static void vc_morph_linha(vc_morph_fase *f, int o, unsigned char *out,
+                           const unsigned char *(*obter)(void *ctx, int y, unsigned char *tmp), void *ctx, unsigned char *tmp)
+{
+    // A linha o-r-1 sai da janela antes que a linha o+r ocupe a mesma posição do anel
+    if (o - f->r - 1 >= 0)
+    {
+        const unsigned char *h = &f->anel[((o - f->r - 1) % f->k) * f->width];
+        for (int x = 0; x < f->width; x++) f->soma[x] -= h[x];
+    }
+
+    int fim = (o + f->r < f->height) ? o + f->r : f->height - 1;
+    while (f->linhas <= fim) vc_morph_acrescentar(f, obter(ctx, f->linhas, tmp));
+
+    int n = fim - ((o - f->r > 0) ? o - f->r : 0) + 1;
+    if (f->dilatar)
+        for (int x = 0; x < f->width; x++) out[x] = (f->soma[x] > 0) ? 255 : 0;
+    else
+        for (int x = 0; x < f->width; x++) out[x] = (f->soma[x] == n) ? 255 : 0;
+}
+
+typedef struct {
+    IVC *src;
+    vc_morph_fase *primeira;
+} vc_morph_fluxo;
+
+// Entrada da primeira fase: as linhas da origem, lidas diretamente da imagem
+static const unsigned char *vc_morph_obter_origem(void *ctx, int y, unsigned char *tmp)
+{
+    vc_morph_fluxo *fluxo = (vc_morph_fluxo *) ctx;
+    (void) tmp;
+    return &fluxo->src->data[y * fluxo->src->bytesperline];
+}
+
+// Entrada da segunda fase: as linhas de saída da primeira
+static const unsigned char *vc_morph_obter_fase(void *ctx, int y, unsigned char *tmp)
+{
+    vc_morph_fluxo *fluxo = (vc_morph_fluxo *) ctx;
+    vc_morph_linha(fluxo->primeira, y, tmp, vc_morph_obter_origem, ctx, NULL);
+    return tmp;
+}
+
+// Função comum ao fecho (dilatação seguida de erosão) e à abertura (erosão seguida de dilatação)
+static int vc_binary_morph_fused(IVC *src, IVC *dst, int kernel_size, int fecho, const char *nome)
+{
+    if ((src == NULL) || (dst == NULL) || (kernel_size <= 0)) return 0;
+    if ((src->width != dst->width) || (src->height != dst->height) || (src->channels != 1) || (dst->channels != 1)) return 0;
+
+    int width = src->width, height = src->height;
+    int r = kernel_size / 2, k = 2 * r + 1;
+    (void) nome;
+
+    // Dois anéis de k linhas, duas somas por coluna e a linha intermédia
+    size_t anel = (size_t) k * width;
+    unsigned char *memoria = (unsigned char *) malloc(2 * (size_t) width * sizeof(int) + 2 * anel + (size_t) width);
+    if (memoria == NULL)
+    {
+#ifdef VC_DEBUG
+        vc_log(VC_LOG_ERRO, "ERROR -> %s():\n\tOut of memory!\n", nome);
+#endif
+        return 0;
+    }
+
+    int *somas = (int *) memoria;
+    memset(somas, 0, 2 * (size_t) width * sizeof(int));
+    unsigned char *aneis = memoria + 2 * (size_t) width * sizeof(int);
+    unsigned char *linha = aneis + 2 * anel;
+
+    vc_morph_fase primeira = { r, k, width, height, fecho, aneis, somas, 0 };
+    vc_morph_fase segunda = { r, k, width, height, !fecho, aneis + anel, somas + width, 0 };
+    vc_morph_fluxo fluxo = { src, &primeira };
+
+    for (int y = 0; y < height; y++)
+        vc_morph_linha(&segunda, y, &dst->data[y * dst->bytesperline], vc_morph_obter_fase, &fluxo, linha);
+
+    free(memoria);
+
+    return 1;
+}
+
+// Função para o fecho binário (dilatação seguida de erosão, kernel quadrado); src pode ser igual a dst
+int vc_binary_close(IVC *src, IVC *dst, int kernel_size)
+{
+    return vc_binary_morph_fused(src, dst, kernel_size, 1, "vc_binary_close");
+}
+
+// Função para a abertura binária (erosão seguida de dilatação, kernel quadrado); src pode ser igual a dst
+int vc_binary_open(IVC *src, IVC *dst, int kernel_size)
+{
+    return vc_binary_morph_fused(src, dst, kernel_size, 0, "vc_binary_open");
+}
+
+//++++ TRANSFORMADA DE DISTÂNCIA EUCLIDIANA (EXATA, O(N)) ++++
+// Felzenszwalb & Huttenlocher: primeiro a distância vertical de cada píxel ao fundo mais próximo da
+// sua coluna; depois, em cada linha, o mínimo de (x - q)^2 + g(q)^2 pelo envelope inferior das
+// parábolas centradas em cada q. Cada passagem é independente por coluna/linha, o que permite
+// dividi-las por threads. As distâncias ao quadrado são inteiras e exatas.
+
+#define VC_EDT_INFINITO 0x3fffffff
+
+// Passagem vertical: g = distância (em linhas) ao píxel de fundo mais próximo na mesma coluna
+static void vc_edt_colunas(IVC *src, int *g, int x1, int x2)
+{
+    int width = src->width, height = src->height;
+    int lim = width + height;
+
+    for (int x = x1; x < x2; x++)
+        g[x] = (src->data[x] == 0) ? 0 : lim;
+
+    for (int y = 1; y < height; y++)
+    {
+        const unsigned char *s = &src->data[y * src->bytesperline];
+        const int *acima = &g[(y - 1) * width];
+        int *linha = &g[y * width];
+        for (int x = x1; x < x2; x++) linha[x] = (s[x] == 0) ? 0 : ((acima[x] < lim) ? acima[x] + 1 : lim);
+    }
+
+    for (int y = height - 2; y >= 0; y--)
+    {
+        const int *abaixo = &g[(y + 1) * width];
+        int *linha = &g[y * width];
+        for (int x = x1; x < x2; x++) if (abaixo[x] + 1 < linha[x]) linha[x] = abaixo[x] + 1;
+    }
+}
+
+// Passagem horizontal numa linha: d2[x] = min_q (x - q)^2 + g[q]^2 (VC_EDT_INFINITO sem fundo)
+static void vc_edt_linha(const int *g, int *d2, int width, int lim, int *v, double *z)
+{
+    int k = -1;
+
+    for (int q = 0; q < width; q++)
+    {
+        if (g[q] >= lim) continue;
+
+        long long fq = (long long) g[q] * g[q] + (long long) q * q;
+        double s = -HUGE_VAL;
+        while (k >= 0)
+        {
+            int p = v[k];
+            long long fp = (long long) g[p] * g[p] + (long long) p * p;
+            s = (double) (fq - fp) / (2.0 * (q - p));
+            if (s > z[k]) break;
+            k--;
+        }
+        if (k < 0) s = -HUGE_VAL;
+        v[++k] = q;
+        z[k] = s;
+    }
+
+    if (k < 0)
+    {
+        for (int x = 0; x < width; x++) d2[x] = VC_EDT_INFINITO;
+        return;
+    }
+
+    int n = k, j = 0;
+    for (int x = 0; x < width; x++)
+    {
+        while ((j < n) && (z[j + 1] < x)) j++;
+        long long d = (long long) (x - v[j]) * (x - v[j]) + (long long) g[v[j]] * g[v[j]];
+        d2[x] = (d < VC_EDT_INFINITO) ? (int) d : VC_EDT_INFINITO;
+    }
+}
+
+// Função comum: distância de cada píxel branco (!= 0) ao píxel preto mais próximo, em float ou uint16
+static int vc_edt(IVC *src, float *fdst, unsigned short *udst, const char *nome)
+{
+    if ((src == NULL) || (src->channels != 1) || ((fdst == NULL) && (udst == NULL))) return 0;
+    (void) nome;
+
+    int width = src->width, height = src->height;
+    int lim = width + height;
+    int *g = (int *) malloc((size_t) width * height * sizeof(int));
+    if (g == NULL)
+    {
+#ifdef VC_DEBUG
+        vc_log(VC_LOG_ERRO, "ERROR -> %s():\n\tOut of memory!\n", nome);
+#endif
+        return 0;
+    }
+
+    int ok = 1;
+#ifdef _OPENMP
+    int nthreads = (width * height >= 65536) ? vc_num_threads : 1;
+#endif
+
+    // Colunas em blocos de 64 (as linhas de cada bloco são contíguas em memória)
+    int nblocos = (width + 63) / 64;
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static) num_threads(nthreads) if (nthreads > 1)
+#endif
+    for (int b = 0; b < nblocos; b++)
+        vc_edt_colunas(src, g, b * 64, (b * 64 + 64 < width) ? b * 64 + 64 : width);
+
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(nthreads) if (nthreads > 1)
+#endif
+    {
+        // Por thread: a linha de resultados, os vértices e as fronteiras do envelope
+        int *d2 = (int *) malloc((size_t) width * 2 * sizeof(int));
+        double *z = (double *) malloc((size_t) (width + 1) * sizeof(double));
+
+        if ((d2 == NULL) || (z == NULL))
+        {
+#ifdef _OPENMP
+            #pragma omp atomic write
+#endif
+            ok = 0;
+        }
+
+#ifdef _OPENMP
+        #pragma omp for schedule(static)
+#endif
+        for (int y = 0; y < height; y++)
+        {
+            if ((d2 == NULL) || (z == NULL)) continue;
+
+            vc_edt_linha(&g[y * width], d2, width, lim, d2 + width, z);
+
+            if (fdst != NULL)
+            {
+                float *o = &fdst[(size_t) y * width];
+                for (int x = 0; x < width; x++) o[x] = (d2[x] == VC_EDT_INFINITO) ? HUGE_VALF : sqrtf((float) d2[x]);
+            }
+            else
+            {
+                unsigned short *o = &udst[(size_t) y * width];
+                for (int x = 0; x < width; x++)
+                {
+                    float d = sqrtf((float) d2[x]) + 0.5f;
+                    o[x] = (d2[x] == VC_EDT_INFINITO || d >= 65535.0f) ? 65535 : (unsigned short) d;
+                }
+            }
+        }
+
+        free(d2);
+        free(z);
+    }
+
+    free(g);
+
+#ifdef VC_DEBUG
+    if (!ok) vc_log(VC_LOG_ERRO, "ERROR -> %s():\n\tOut of memory!\n", nome);
+#endif
+
+    return ok;
+}
+
+// Função para calcular a distância euclidiana exata de cada píxel branco ao píxel preto mais próximo
+// dst: width * height floats (0 no fundo; infinito se a imagem não tiver fundo)
+int vc_binary_distance_transform(IVC *src, float *dst)
+{
+    return vc_edt(src, dst, NULL, "vc_binary_distance_transform");
+}
+
+// Igual, com a distância arredondada em 16 bits (65535 = sem fundo ou fora do alcance)
+int vc_binary_distance_transform_u16(IVC *src, unsigned short *dst)
+{
+    return vc_edt(src, NULL, dst, "vc_binary_distance_transform_u16");
+}
+
+// Função para obter, por blob etiquetado, a maior distância ao fundo (raio do maior círculo inscrito)
+// Percorre só as sequências (runs) da etiquetagem; radius tem blobs->nblobs posições
+int vc_blobs_max_distance(BVC *blobs, const float *dist, int width, float *radius)
+{
+    if ((blobs == NULL) || (dist == NULL) || (radius == NULL)) return 0;
+
+    for (int k = 0; k < blobs->nblobs; k++) radius[k] = 0.0f;
+
+    for (int i = 0; i < blobs->nruns; i++)
+    {
+        const RVC *run = &blobs->runs[i];
+        const float *d = &dist[(size_t) run->y * width];
+        float m = radius[run->label - 1];
+        for (int x = run->x1; x <= run->x2; x++) if (d[x] > m) m = d[x];
+        radius[run->label - 1] = m;
+    }
+
+    return 1;
+}
+
+//++++ SEPARAÇÃO DE REGIÕES QUE SE TOCAM (WATERSHED COM MARCADORES) ++++
+
+// Função para separar regiões que se tocam: watershed controlado por marcadores sobre a distância ao fundo.
+// Os marcadores são as componentes (conectividade 8) de {distância >= fraction * máximo}; as bacias crescem
+// por ordem decrescente de distância, numa fila de prioridade com um balde por nível inteiro, e os píxeis
+// onde duas bacias se encontram passam a preto, quebrando a conectividade 8 entre elas.
+// Pensada para uma região de cada vez (a caixa de um blob), rodeada de preto: a margem da imagem não conta
+// como fundo. Devolve o número de bacias (1 = nada a separar) ou 0 em caso de erro.
+int vc_binary_watershed_split(IVC *srcdst, float fraction)
+{
+    static const int dx[8] = { -1, 0, 1, -1, 1, -1, 0, 1 };
+    static const int dy[8] = { -1, -1, -1, 0, 0, 1, 1, 1 };
+
+    if ((srcdst == NULL) || (srcdst->channels != 1) || (fraction <= 0.0f) || (fraction > 1.0f)) return 0;
+
+    int width = srcdst->width, height = srcdst->height;
+    size_t n = (size_t) width * height;
+    unsigned short *dist = (unsigned short *) malloc(n * sizeof(unsigned short));
+    int *label = (int *) calloc(n, sizeof(int));
+    int *next = (int *) malloc(n * sizeof(int));
+    int *head = NULL, *tail = NULL;
+    int nbacias = 1;
+
+    if ((dist == NULL) || (label == NULL) || (next == NULL) || !vc_binary_distance_transform_u16(srcdst, dist))
+    {
+        nbacias = 0;
+        goto fim;
+    }
+
+    // Distância máxima (sem píxeis brancos ou sem fundo na imagem não há nada a separar)
+    int dmax = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (dist[i] == 65535) goto fim;
+        if (dist[i] > dmax) dmax = dist[i];
+    }
+    if (dmax == 0) goto fim;
+
+    int limiar = (int) ceilf(fraction * dmax);
+    if (limiar < 1) limiar = 1;
+
+    // Marcadores: componentes de {dist >= limiar}, etiquetadas em largura (next[] serve de fila)
+    nbacias = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        if ((dist[i] < limiar) || (label[i] != 0)) continue;
+
+        int inicio = 0, fimFila = 0;
+        label[i] = ++nbacias;
+        next[fimFila++] = (int) i;
+        while (inicio < fimFila)
+        {
+            int p = next[inicio++];
+            int px = p % width, py = p / width;
+            for (int k = 0; k < 8; k++)
+            {
+                int qx = px + dx[k], qy = py + dy[k];
+                if ((qx < 0) || (qx >= width) || (qy < 0) || (qy >= height)) continue;
+                int q = qy * width + qx;
+                if ((dist[q] >= limiar) && (label[q] == 0))
+                {
+                    label[q] = nbacias;
+                    next[fimFila++] = q;
+                }
+            }
+        }
+    }
+    if (nbacias < 2) goto fim;
+
+    // Fila de prioridade: nível = dmax - distância (os centros saem primeiro); um balde FIFO por nível
+    head = (int *) malloc((size_t) (dmax + 1) * sizeof(int));
+    tail = (int *) malloc((size_t) (dmax + 1) * sizeof(int));
+    if ((head == NULL) || (tail == NULL)) { nbacias = 0; goto fim; }
+    for (int l = 0; l <= dmax; l++) head[l] = tail[l] = -1;
+
+#define VC_WS_PUSH(p, nivel) do { int l_ = (nivel); next[p] = -1; \
+        if (tail[l_] < 0) head[l_] = (p); else next[tail[l_]] = (p); tail[l_] = (p); } while (0)
+
+    for (size_t i = 0; i < n; i++)
+        if (label[i] != 0) VC_WS_PUSH((int) i, dmax - dist[i]);
+
+    // Inundação: cada píxel branco fica com a bacia que o alcança primeiro (o nível nunca desce)
+    for (int nivel = 0; nivel <= dmax; nivel++)
+    {
+        while (head[nivel] >= 0)
+        {
+            int p = head[nivel];
+            head[nivel] = next[p];
+            if (head[nivel] < 0) tail[nivel] = -1;
+
+            int px = p % width, py = p / width;
+            for (int k = 0; k < 8; k++)
+            {
+                int qx = px + dx[k], qy = py + dy[k];
+                if ((qx < 0) || (qx >= width) || (qy < 0) || (qy >= height)) continue;
+                int q = qy * width + qx;
+                if ((dist[q] == 0) || (label[q] != 0)) continue;
+
+                label[q] = label[p];
+                int lq = dmax - dist[q];
+                VC_WS_PUSH(q, (lq > nivel) ? lq : nivel);
+            }
+        }
+    }
+
+#undef VC_WS_PUSH
+
+    // Linhas de separação: um píxel vizinho de uma bacia de etiqueta maior passa a preto
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            int a = label[y * width + x];
+            if (a == 0) continue;
+
+            for (int k = 0; k < 8; k++)
+            {
+                int qx = x + dx[k], qy = y + dy[k];
+                if ((qx < 0) || (qx >= width) || (qy < 0) || (qy >= height)) continue;
+                if (label[qy * width + qx] > a)
+                {
+                    srcdst->data[y * srcdst->bytesperline + x] = 0;
+                    break;
+                }
+            }
+        }
+    }
+
+fim:
+#ifdef VC_DEBUG
+    if (nbacias == 0) vc_log(VC_LOG_ERRO, "ERROR -> vc_binary_watershed_split():\n\tOut of memory!\n");
+#endif
+    free(dist);
+    free(label);
+    free(next);
+    free(head);
+    free(tail);
+
+    return nbacias;
+}
+
+int vc_gray_to_binary_adaptive_mean(IVC *src, IVC *dst, int windowSize, int offset)
+{
+    int halfWindow = windowSize / 2;
+
+    if ((src == NULL) || (dst == NULL)) return 0;
+    if ((src->width != dst->width) || (src->height != dst->height) || (src->channels != 1) || (dst->channels != 1)) return 0;
+
+    for (int y = halfWindow; y < src->height - halfWindow; y++)
+    {
+        for (int x = halfWindow; x < src->width - halfWindow; x++)
+        {
+            int sum = 0;
+            for (int wy = -halfWindow; wy <= halfWindow; wy++)
+            {
+                for (int wx = -halfWindow; wx <= halfWindow; wx++)
+                {
+                    sum += src->data[(y + wy) * src->bytesperline + (x + wx)];
+                }
+            }
+            int area = windowSize * windowSize;
+            int localMean = sum / area;
+
+            int pixel = src->data[y * src->bytesperline + x];
+            dst->data[y * dst->bytesperline + x] = (pixel < (localMean - offset)) ? 0 : 255;
+        }
+    }
+
+    return 1;
+}
+
+
+int vc_gray_gaussian_blur(IVC *src, IVC *dst)
+{
+    // Kernel 5x5 (soma 273), aplicado só aos píxeis interiores:
+    // {1, 4, 7, 4, 1}, {4, 16, 26, 16, 4}, {7, 26, 41, 26, 7}, {4, 16, 26, 16, 4}, {1, 4, 7, 4, 1}
+    if ((src == NULL) || (dst == NULL)) return 0;
+    if ((src->width != dst->width) || (src->height != dst->height) || (src->channels != 1) || (dst->channels != 1)) return 0;
+    if (vc_kernels.level < 0) vc_cpu_init();
+
+    for (int y = 2; y < src->height - 2; y++)
+        vc_kernels.blur5_row(&src->data[(y - 2) * src->bytesperline], src->bytesperline, &dst->data[y * dst->bytesperline], 2, src->width - 2);
+
+    return 1;
+}
+
+
+// Média arredondada de dois valores (igual a _mm_avg_epu8)
+static inline unsigned char vc_avg2(unsigned char a, unsigned char b)
+{
+    return (unsigned char)((a + b + 1) >> 1);
+}
+
+#ifdef VC_SSE2
+// Média dos pares de bytes adjacentes (0+1, 2+3, ...) em 8 valores de 16 bits
+static inline __m128i vc_sse2_avg_pairs(__m128i v)
+{
+    __m128i even = _mm_and_si128(v, _mm_set1_epi16(0x00FF));
+    __m128i odd = _mm_srli_epi16(v, 8);
+    return _mm_avg_epu16(even, odd);
+}
+#endif
+
+// Função para reduzir a resolução de uma imagem por um fator de 2 ou 4 (média de blocos fator x fator)
+// A média é feita aos pares (primeiro na vertical, depois na horizontal), como _mm_avg_epu8
+int vc_image_downscale(IVC *src, IVC *dst, int factor)
+{
+    if ((src == NULL) || (dst == NULL)) return 0;
+    if ((factor != 2) && (factor != 4)) return 0;
+    if ((dst->width != src->width / factor) || (dst->height != src->height / factor) || (src->channels != dst->channels)) return 0;
+
+    int channels = src->channels;
+    int rowlen = dst->width * factor * channels;
+    unsigned char *row = (unsigned char *) malloc(rowlen);
+    if (row == NULL) return 0;
+
+    for (int y = 0; y < dst->height; y++)
+    {
+        unsigned char *r0 = &src->data[(y * factor) * src->bytesperline];
+        unsigned char *r1 = r0 + src->bytesperline;
+        unsigned char *out = &dst->data[y * dst->bytesperline];
+        int i = 0;
+
+        // Redução vertical (independente do número de canais)
+        if (factor == 2)
+        {
+#ifdef VC_SSE2
+            for (; i + 16 <= rowlen; i += 16)
+            {
+                __m128i a = _mm_loadu_si128((const __m128i *) &r0[i]);
+                __m128i b = _mm_loadu_si128((const __m128i *) &r1[i]);
+                _mm_storeu_si128((__m128i *) &row[i], _mm_avg_epu8(a, b));
+            }
+#endif
+            for (; i < rowlen; i++)
+                row[i] = vc_avg2(r0[i], r1[i]);
+        }
+        else
+        {
+            unsigned char *r2 = r1 + src->bytesperline;
+            unsigned char *r3 = r2 + src->bytesperline;
+#ifdef VC_SSE2
+            for (; i + 16 <= rowlen; i += 16)
+            {
+                __m128i a = _mm_avg_epu8(_mm_loadu_si128((const __m128i *) &r0[i]), _mm_loadu_si128((const __m128i *) &r1[i]));
+                __m128i b = _mm_avg_epu8(_mm_loadu_si128((const __m128i *) &r2[i]), _mm_loadu_si128((const __m128i *) &r3[i]));
+                _mm_storeu_si128((__m128i *) &row[i], _mm_avg_epu8(a, b));
+            }
+#endif
+            for (; i < rowlen; i++)
+                row[i] = vc_avg2(vc_avg2(r0[i], r1[i]), vc_avg2(r2[i], r3[i]));
+        }
+
+        // Redução horizontal
+        int x = 0;
+#ifdef VC_SSE2
+        if ((channels == 1) && (factor == 2))
+        {
+            for (; x + 16 <= dst->width; x += 16)
+            {
+                __m128i a = vc_sse2_avg_pairs(_mm_loadu_si128((const __m128i *) &row[x * 2]));
+                __m128i b = vc_sse2_avg_pairs(_mm_loadu_si128((const __m128i *) &row[x * 2 + 16]));
+                _mm_storeu_si128((__m128i *) &out[x], _mm_packus_epi16(a, b));
+            }
+        }
+        else if ((channels == 1) && (factor == 4))
+        {
+            for (; x + 16 <= dst->width; x += 16)
+            {
+                __m128i a = _mm_packus_epi16(vc_sse2_avg_pairs(_mm_loadu_si128((const __m128i *) &row[x * 4])),
+                                             vc_sse2_avg_pairs(_mm_loadu_si128((const __m128i *) &row[x * 4 + 16])));
+                __m128i b = _mm_packus_epi16(vc_sse2_avg_pairs(_mm_loadu_si128((const __m128i *) &row[x * 4 + 32])),
+                                             vc_sse2_avg_pairs(_mm_loadu_si128((const __m128i *) &row[x * 4 + 48])));
+                _mm_storeu_si128((__m128i *) &out[x], _mm_packus_epi16(vc_sse2_avg_pairs(a), vc_sse2_avg_pairs(b)));
+            }
+        }
+#endif
+        for (; x < dst->width; x++)
+        {
+            unsigned char *p = &row[x * factor * channels];
+            for (int c = 0; c < channels; c++)
+            {
+                if (factor == 2)
+                    out[x * channels + c] = vc_avg2(p[c], p[channels + c]);
+                else
+                    out[x * channels + c] = vc_avg2(vc_avg2(p[c], p[channels + c]), vc_avg2(p[2 * channels + c], p[3 * channels + c]));
+            }
+        }
+    }
+
+    free(row);
+
+    return 1;
+}
+
+// Função para copiar uma região (x, y, dst->width, dst->height) da imagem src para dst
+int vc_image_crop(IVC *src, IVC *dst, int x, int y)
+{
+    if ((src == NULL) || (dst == NULL)) return 0;
+    if ((src->channels != dst->channels) || (x < 0) || (y < 0)) return 0;
+    if ((x + dst->width > src->width) || (y + dst->height > src->height)) return 0;
+
+    for (int j = 0; j < dst->height; j++)
+    {
+        memcpy(&dst->data[j * dst->bytesperline], &src->data[(y + j) * src->bytesperline + x * src->channels], dst->width * dst->channels);
+    }
+
+    return 1;
+}
+
+// Função para alocar um contorno vazio
+CVC* vc_contour_new(void)
+{
+    CVC *contour = (CVC *) calloc(1, sizeof(CVC));
+
+    return contour;
+}
+
+// Função para libertar a memória de um contorno
+CVC* vc_contour_free(CVC* contour)
+{
+    if (contour != NULL)
+    {
+        free(contour->x);
+        free(contour->y);
+        free(contour->chain);
+        free(contour);
+    }
+
+    return NULL;
+}
+
+// Função auxiliar para acrescentar um ponto ao contorno (a capacidade duplica quando esgota)
+static int vc_contour_push(CVC *contour, int x, int y)
+{
+    if (contour->npoints == contour->capacity)
+    {
+        int capacity = (contour->capacity > 0) ? contour->capacity * 2 : 256;
+        int *nx = (int *) realloc(contour->x, capacity * sizeof(int));
+        if (nx == NULL) return 0;
+        contour->x = nx;
+        int *ny = (int *) realloc(contour->y, capacity * sizeof(int));
+        if (ny == NULL) return 0;
+        contour->y = ny;
+        unsigned char *nc = (unsigned char *) realloc(contour->chain, capacity);
+        if (nc == NULL) return 0;
+        contour->chain = nc;
+        contour->capacity = capacity;
+    }
+
+    contour->x[contour->npoints] = x;
+    contour->y[contour->npoints] = y;
+    contour->npoints++;
+
+    return 1;
+}
+
+// Função para seguir o contorno exterior de uma região (vizinhança de Moore, conectividade 8)
+// (x, y) deve ser o primeiro pixel da região em varrimento raster (canto superior esquerdo).
+// Só são visitados pixels da fronteira: o custo é proporcional ao comprimento do contorno.
+int vc_binary_contour_trace(IVC* src, int x, int y, CVC* contour)
+{
+    // Direções de Freeman (sentido anti-horário, com o eixo y a crescer para baixo)
+    static const int dx[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+    static const int dy[8] = { 0, -1, -1, -1, 0, 1, 1, 1 };
+
+    if ((src == NULL) || (contour == NULL) || (src->channels != 1)) return 0;
+    if ((x < 0) || (x >= src->width) || (y < 0) || (y >= src->height)) return 0;
+    if (src->data[y * src->bytesperline + x] == 0) return 0;
+
+    contour->npoints = 0;
+    contour->perimeter = 0.0;
+    if (!vc_contour_push(contour, x, y)) return 0;
+
+    int cx = x, cy = y;
+    int dir = 7;
+    int x1 = -1, y1 = -1; // Segundo pixel do contorno (critério de paragem)
+
+    for (;;)
+    {
+        // Procurar o próximo pixel da fronteira, a partir da direção anterior
+        int start = (dir & 1) ? (dir + 6) % 8 : (dir + 7) % 8;
+        int d = -1, nx = 0, ny = 0;
+
+        for (int k = 0; k < 8; k++)
+        {
+            int dd = (start + k) % 8;
+            nx = cx + dx[dd];
+            ny = cy + dy[dd];
+            if ((nx >= 0) && (nx < src->width) && (ny >= 0) && (ny < src->height) && (src->data[ny * src->bytesperline + nx] != 0))
+            {
+                d = dd;
+                break;
+            }
+        }
+
+        // Pixel isolado
+        if (d < 0) break;
+
+        // Voltámos ao início e o próximo passo repete o primeiro: o contorno está fechado
+        if ((cx == x) && (cy == y) && (contour->npoints > 1) && (nx == x1) && (ny == y1))
+        {
+            contour->npoints--;
+            break;
+        }
+
+        if (contour->npoints == 1)
+        {
+            x1 = nx;
+            y1 = ny;
+        }
+
+        contour->chain[contour->npoints - 1] = (unsigned char) d;
+        contour->perimeter += (d & 1) ? 1.41421356237309504880 : 1.0;
+
+        cx = nx;
+        cy = ny;
+        dir = d;
+        if (!vc_contour_push(contour, cx, cy)) return 0;
+    }
+
+    return 1;
+}
+
+// Acumuladores de uma etiqueta provisória (momentos inteiros: a soma é exata e independente da ordem)
+struct vc_blob_acc {
+    long long m00, m10, m01, m20, m11, m02, m30, m21, m12, m03;
+    int x1, y1, x2, y2;
+    int xstart, ystart;
+};
+
+// Função para alocar um contexto de etiquetagem vazio
+BVC* vc_blobs_new(void)
+{
+    BVC *blobs = (BVC *) calloc(1, sizeof(BVC));
+
+    return blobs;
+}
+
+// Função para libertar a memória de um contexto de etiquetagem
+BVC* vc_blobs_free(BVC* blobs)
+{
+    if (blobs != NULL)
+    {
+        free(blobs->runs);
+        free(blobs->blobs);
+        free(blobs->parent);
+        free(blobs->acc);
+        for (int i = 0; i < blobs->strips_capacity; i++)
+        {
+            free(blobs->strips[i].runs);
+            free(blobs->strips[i].parent);
+            free(blobs->strips[i].acc);
+        }
+        free(blobs->strips);
+        free(blobs);
+    }
+
+    return NULL;
+}
+
+// Índice do primeiro bit a 1 (mask != 0)
+static inline int vc_ctz(unsigned int mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(mask);
+#else
+    int i = 0;
+    while (!(mask & 1u)) { mask >>= 1; i++; }
+    return i;
+#endif
+}
+
+// Procura, a partir de x, o primeiro pixel com (valor != 0) == white; devolve width se não existir
+static int vc_row_find(const unsigned char *row, int x, int width, int white)
+{
+#ifdef VC_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 16 <= width; x += 16)
+    {
+        unsigned int mask = (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) &row[x]), zero));
+        if (white) mask = ~mask & 0xFFFF;
+        if (mask) return x + vc_ctz(mask);
+    }
+#endif
+    for (; x < width; x++)
+        if ((row[x] != 0) == white) return x;
+
+    return width;
+}
+
+// Soma de k, k^2 e k^3 para k em [0, n]
+static inline long long vc_sum1(long long n) { return n * (n + 1) / 2; }
+static inline long long vc_sum2(long long n) { return n * (n + 1) * (2 * n + 1) / 6; }
+static inline long long vc_sum3(long long n) { long long s = n * (n + 1) / 2; return s * s; }
+
+// Acrescenta a sequência [x1, x2] da linha y aos acumuladores (somas em forma fechada)
+static inline void vc_blob_acc_add_run(struct vc_blob_acc *a, int y, int x1, int x2)
+{
+    long long n = x2 - x1 + 1;
+    long long s1 = vc_sum1(x2) - vc_sum1(x1 - 1);
+    long long s2 = vc_sum2(x2) - vc_sum2(x1 - 1);
+    long long s3 = vc_sum3(x2) - vc_sum3(x1 - 1);
+    long long yy = y;
+
+    a->m00 += n;
+    a->m10 += s1;
+    a->m01 += yy * n;
+    a->m20 += s2;
+    a->m11 += yy * s1;
+    a->m02 += yy * yy * n;
+    a->m30 += s3;
+    a->m21 += yy * s2;
+    a->m12 += yy * yy * s1;
+    a->m03 += yy * yy * yy * n;
+    if (x1 < a->x1) a->x1 = x1;
+    if (x2 > a->x2) a->x2 = x2;
+    if (y < a->y1) a->y1 = y;
+    if (y > a->y2) a->y2 = y;
+}
+
+// Junta os acumuladores b em a
+static inline void vc_blob_acc_merge(struct vc_blob_acc *a, const struct vc_blob_acc *b)
+{
+    a->m00 += b->m00; a->m10 += b->m10; a->m01 += b->m01;
+    a->m20 += b->m20; a->m11 += b->m11; a->m02 += b->m02;
+    a->m30 += b->m30; a->m21 += b->m21; a->m12 += b->m12; a->m03 += b->m03;
+    if (b->x1 < a->x1) a->x1 = b->x1;
+    if (b->x2 > a->x2) a->x2 = b->x2;
+    if (b->y1 < a->y1) a->y1 = b->y1;
+    if (b->y2 > a->y2) a->y2 = b->y2;
+}
+
+// Union-find: raiz com compressão de caminho por halving
+static inline int vc_uf_find(int *parent, int l)
+{
+    while (parent[l] != l)
+    {
+        parent[l] = parent[parent[l]];
+        l = parent[l];
+    }
+    return l;
+}
+
+// Union-find: a raiz é sempre a menor etiqueta (a primeira a aparecer em varrimento raster)
+static inline int vc_uf_union(int *parent, int a, int b)
+{
+    a = vc_uf_find(parent, a);
+    b = vc_uf_find(parent, b);
+    if (a < b) { parent[b] = a; return a; }
+    parent[a] = b;
+    return b;
+}
+
+#ifdef _OPENMP
+// Leitura e troca atómicas de parent[l] (union-find partilhado entre threads, sem locks)
+static inline int vc_atomic_load(int *p)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#else
+    return *(volatile int *) p;
+#endif
+}
+
+static inline int vc_atomic_cas(int *p, int expected, int desired)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __atomic_compare_exchange_n(p, &expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#elif defined(_WIN32)
+    return InterlockedCompareExchange((volatile LONG *) p, desired, expected) == expected;
+#else
+    int ok = 0;
+    #pragma omp critical (vc_atomic_cas)
+    {
+        if (*p == expected)
+        {
+            *p = desired;
+            ok = 1;
+        }
+    }
+    return ok;
+#endif
+}
+
+// Union-find sem locks: liga sempre a raiz maior à menor, como vc_uf_union (parent[l] < l nas
+// etiquetas que não são raiz). Se outra thread ligar a raiz entretanto, a troca falha e recomeça.
+static void vc_uf_union_atomic(int *parent, int a, int b)
+{
+    for (;;)
+    {
+        int p;
+        while ((p = vc_atomic_load(&parent[a])) != a) a = p;
+        while ((p = vc_atomic_load(&parent[b])) != b) b = p;
+        if (a == b) return;
+        if (a < b) { p = a; a = b; b = p; }
+        if (vc_atomic_cas(&parent[a], a, b)) return;
+    }
+}
+#endif
+
+// Função auxiliar para garantir capacidade num vetor (duplica quando esgota)
+static int vc_grow(void **ptr, int *capacity, int needed, size_t elemsize)
+{
+    if (needed <= *capacity) return 1;
+
+    int capacity_new = (*capacity > 0) ? *capacity : 256;
+    while (capacity_new < needed) capacity_new *= 2;
+
+    void *p = realloc(*ptr, capacity_new * elemsize);
+    if (p == NULL) return 0;
+
+    *ptr = p;
+    *capacity = capacity_new;
+
+    return 1;
+}
+
+// Calcula centro de massa, momentos centrais, momentos de Hu e descritores da elipse equivalente
+static void vc_blob_features(OVC *blob, const struct vc_blob_acc *a)
+{
+    double m00 = (double) a->m00;
+    double cx = (double) a->m10 / m00;
+    double cy = (double) a->m01 / m00;
+
+    blob->area = (int) a->m00;
+    blob->x = a->x1;
+    blob->y = a->y1;
+    blob->width = a->x2 - a->x1 + 1;
+    blob->height = a->y2 - a->y1 + 1;
+    blob->xstart = a->xstart;
+    blob->ystart = a->ystart;
+    blob->cx = cx;
+    blob->cy = cy;
+    blob->xc = (int) (cx + 0.5);
+    blob->yc = (int) (cy + 0.5);
+    blob->m10 = a->m10; blob->m01 = a->m01;
+    blob->m20 = a->m20; blob->m11 = a->m11; blob->m02 = a->m02;
+    blob->m30 = a->m30; blob->m21 = a->m21; blob->m12 = a->m12; blob->m03 = a->m03;
+
+    // Momentos centrais a partir dos momentos brutos
+    double m10 = (double) a->m10, m01 = (double) a->m01;
+    double m20 = (double) a->m20, m11 = (double) a->m11, m02 = (double) a->m02;
+    blob->mu20 = m20 - cx * m10;
+    blob->mu02 = m02 - cy * m01;
+    blob->mu11 = m11 - cx * m01;
+    blob->mu30 = (double) a->m30 - 3.0 * cx * m20 + 2.0 * cx * cx * m10;
+    blob->mu03 = (double) a->m03 - 3.0 * cy * m02 + 2.0 * cy * cy * m01;
+    blob->mu21 = (double) a->m21 - 2.0 * cx * m11 - cy * m20 + 2.0 * cx * cx * m01;
+    blob->mu12 = (double) a->m12 - 2.0 * cy * m11 - cx * m02 + 2.0 * cy * cy * m10;
+
+    // Momentos centrais normalizados e invariantes de Hu
+    double s2 = m00 * m00;
+    double s3 = s2 * sqrt(m00);
+    double n20 = blob->mu20 / s2, n11 = blob->mu11 / s2, n02 = blob->mu02 / s2;
+    double n30 = blob->mu30 / s3, n21 = blob->mu21 / s3, n12 = blob->mu12 / s3, n03 = blob->mu03 / s3;
+    double t0 = n30 + n12, t1 = n21 + n03;
+    double q0 = n30 - 3.0 * n12, q1 = 3.0 * n21 - n03;
+
+    blob->hu[0] = n20 + n02;
+    blob->hu[1] = (n20 - n02) * (n20 - n02) + 4.0 * n11 * n11;
+    blob->hu[2] = q0 * q0 + q1 * q1;
+    blob->hu[3] = t0 * t0 + t1 * t1;
+    blob->hu[4] = q0 * t0 * (t0 * t0 - 3.0 * t1 * t1) + q1 * t1 * (3.0 * t0 * t0 - t1 * t1);
+    blob->hu[5] = (n20 - n02) * (t0 * t0 - t1 * t1) + 4.0 * n11 * t0 * t1;
+    blob->hu[6] = q1 * t0 * (t0 * t0 - 3.0 * t1 * t1) - q0 * t1 * (3.0 * t0 * t0 - t1 * t1);
+
+    // Elipse equivalente (valores próprios da matriz de covariância)
+    double a20 = blob->mu20 / m00, a11 = blob->mu11 / m00, a02 = blob->mu02 / m00;
+    double common = sqrt(4.0 * a11 * a11 + (a20 - a02) * (a20 - a02));
+    double l1 = (a20 + a02 + common) / 2.0;
+    double l2 = (a20 + a02 - common) / 2.0;
+
+    blob->eccentricity = (l1 > 0.0) ? sqrt(1.0 - l2 / l1) : 0.0;
+    blob->orientation = 0.5 * atan2(2.0 * a11, a20 - a02);
+    blob->diameter = sqrt(4.0 * m00 / 3.14159265358979323846);
+}
+
+// Função para etiquetar as linhas [y0, y1) de uma imagem binária com etiquetas provisórias (a partir de 1)
+// As sequências e os acumuladores ficam em blobs; devolve 0 se faltar memória
+static int vc_blob_label_rows(IVC *src, int y0, int y1, BVC *blobs)
+{
+    blobs->nruns = 0;
+    blobs->nprovisional = 0;
+
+    int prevStart = 0, prevEnd = 0; // Sequências da linha anterior
+
+    for (int y = y0; y < y1; y++)
+    {
+        const unsigned char *row = &src->data[y * src->bytesperline];
+        int rowStart = blobs->nruns;
+        int p = prevStart;
+        int x = 0;
+
+        for (;;)
+        {
+            int x1 = vc_row_find(row, x, src->width, 1);
+            if (x1 >= src->width) break;
+            int x2 = vc_row_find(row, x1, src->width, 0) - 1;
+            x = x2 + 1;
+
+            // Sequências da linha anterior que tocam [x1 - 1, x2 + 1] (conectividade 8)
+            int label = 0;
+            while ((p < prevEnd) && (blobs->runs[p].x2 < x1 - 1)) p++;
+            for (int q = p; (q < prevEnd) && (blobs->runs[q].x1 <= x2 + 1); q++)
+            {
+                if (label == 0) label = vc_uf_find(blobs->parent, blobs->runs[q].label);
+                else label = vc_uf_union(blobs->parent, label, blobs->runs[q].label);
+            }
+
+            // Nova etiqueta provisória
+            if (label == 0)
+            {
+                int n = blobs->nprovisional + 2;
+                if (!vc_grow((void **) &blobs->parent, &blobs->parent_capacity, n, sizeof(int))) return 0;
+                if (!vc_grow((void **) &blobs->acc, &blobs->acc_capacity, n, sizeof(struct vc_blob_acc))) return 0;
+
+                label = ++blobs->nprovisional;
+                blobs->parent[label] = label;
+                struct vc_blob_acc *a = &blobs->acc[label];
+                memset(a, 0, sizeof(*a));
+                a->x1 = x1; a->x2 = x2; a->y1 = y; a->y2 = y;
+                a->xstart = x1; a->ystart = y;
+            }
+
+            if (!vc_grow((void **) &blobs->runs, &blobs->runs_capacity, blobs->nruns + 1, sizeof(RVC))) return 0;
+            RVC *run = &blobs->runs[blobs->nruns++];
+            run->y = y;
+            run->x1 = x1;
+            run->x2 = x2;
+            run->label = label;
+
+            vc_blob_acc_add_run(&blobs->acc[label], y, x1, x2);
+        }
+
+        prevStart = rowStart;
+        prevEnd = blobs->nruns;
+    }
+
+    return 1;
+}
+
+// Função para resolver as equivalências das etiquetas provisórias e calcular as características dos blobs
+// Devolve o número de blobs (-1 em caso de erro)
+static int vc_blob_resolve(BVC *blobs)
+{
+    // Resolver equivalências. Como parent[l] < l para qualquer etiqueta que não seja raiz,
+    // basta percorrer as etiquetas por ordem crescente: parent[] passa a guardar a etiqueta final
+    // e os acumuladores são juntados no lugar (a etiqueta final k nunca é maior que l)
+    int nblobs = 0;
+    for (int l = 1; l <= blobs->nprovisional; l++)
+    {
+        if (blobs->parent[l] == l)
+        {
+            int k = ++nblobs;
+            blobs->parent[l] = k;
+            if (k != l) blobs->acc[k] = blobs->acc[l];
+        }
+        else
+        {
+            int k = blobs->parent[blobs->parent[l]];
+            blobs->parent[l] = k;
+            vc_blob_acc_merge(&blobs->acc[k], &blobs->acc[l]);
+        }
+    }
+
+    if (!vc_grow((void **) &blobs->blobs, &blobs->blobs_capacity, nblobs, sizeof(OVC))) return -1;
+
+#ifdef _OPENMP
+    int nthreads = (blobs->nruns >= 16384) ? vc_num_threads : 1;
+    #pragma omp parallel num_threads(nthreads) if (nthreads > 1)
+#endif
+    {
+#ifdef _OPENMP
+        #pragma omp for schedule(static)
+#endif
+        for (int i = 0; i < blobs->nruns; i++)
+            blobs->runs[i].label = blobs->parent[blobs->runs[i].label];
+
+#ifdef _OPENMP
+        #pragma omp for schedule(static)
+#endif
+        for (int k = 1; k <= nblobs; k++)
+        {
+            vc_blob_features(&blobs->blobs[k - 1], &blobs->acc[k]);
+            blobs->blobs[k - 1].label = k;
+        }
+    }
+    blobs->nblobs = nblobs;
+
+    return nblobs;
+}
+
+#ifdef _OPENMP
+// Função para etiquetar por faixas de linhas em paralelo (uma faixa por thread)
+// Cada faixa é etiquetada em separado, com etiquetas locais, e as faixas são copiadas seguidas, com as
+// etiquetas deslocadas: as sequências e as etiquetas provisórias ficam pela ordem raster, como na
+// etiquetagem em série. As equivalências entre a última linha de uma faixa e a primeira da seguinte são
+// unidas em paralelo, sem locks. Com a raiz sempre na menor etiqueta, a raiz de cada blob é a etiqueta da
+// sua primeira sequência, pelo que a resolução em série dá as mesmas etiquetas finais e os momentos
+// (inteiros) dos acumuladores parciais de cada faixa somam exatamente o mesmo.
+static int vc_blob_label_strips(IVC *src, BVC *blobs, int nstrips)
+{
+    if (nstrips > blobs->strips_capacity)
+    {
+        BVC *strips = (BVC *) realloc(blobs->strips, nstrips * sizeof(BVC));
+        if (strips == NULL) return -1;
+        memset(&strips[blobs->strips_capacity], 0, (nstrips - blobs->strips_capacity) * sizeof(BVC));
+        blobs->strips = strips;
+        blobs->strips_capacity = nstrips;
+    }
+
+    BVC *strips = blobs->strips;
+    int height = src->height;
+    int erro = 0;
+
+    #pragma omp parallel for schedule(static, 1) num_threads(nstrips) reduction(|:erro)
+    for (int s = 0; s < nstrips; s++)
+        if (!vc_blob_label_rows(src, height * s / nstrips, height * (s + 1) / nstrips, &strips[s])) erro = 1;
+
+    int nruns = 0, nlabels = 0;
+    for (int s = 0; s < nstrips; s++)
+    {
+        nruns += strips[s].nruns;
+        nlabels += strips[s].nprovisional;
+    }
+
+    if (erro ||
+        !vc_grow((void **) &blobs->runs, &blobs->runs_capacity, nruns, sizeof(RVC)) ||
+        !vc_grow((void **) &blobs->parent, &blobs->parent_capacity, nlabels + 2, sizeof(int)) ||
+        !vc_grow((void **) &blobs->acc, &blobs->acc_capacity, nlabels + 2, sizeof(struct vc_blob_acc))) return -1;
+
+    // Copiar cada faixa a seguir às anteriores (etiquetas locais + deslocamento)
+    #pragma omp parallel for schedule(static, 1) num_threads(nstrips)
+    for (int s = 0; s < nstrips; s++)
+    {
+        const BVC *f = &strips[s];
+        int r0 = 0, l0 = 0;
+        for (int t = 0; t < s; t++)
+        {
+            r0 += strips[t].nruns;
+            l0 += strips[t].nprovisional;
+        }
+
+        for (int i = 0; i < f->nruns; i++)
+        {
+            blobs->runs[r0 + i] = f->runs[i];
+            blobs->runs[r0 + i].label += l0;
+        }
+        for (int l = 1; l <= f->nprovisional; l++) blobs->parent[l0 + l] = f->parent[l] + l0;
+        if (f->nprovisional > 0) memcpy(&blobs->acc[l0 + 1], &f->acc[1], f->nprovisional * sizeof(struct vc_blob_acc));
+    }
+    blobs->nruns = nruns;
+    blobs->nprovisional = nlabels;
+
+    // Unir as sequências que se tocam através de cada fronteira entre faixas (conectividade 8)
+    #pragma omp parallel for schedule(static, 1) num_threads(nstrips)
+    for (int s = 1; s < nstrips; s++)
+    {
+        int y = height * s / nstrips;
+        int r0 = 0;
+        for (int t = 0; t < s; t++) r0 += strips[t].nruns;
+
+        // Última linha da faixa anterior em [a, r0), primeira linha desta faixa em [r0, b)
+        int a = r0, b = r0;
+        while ((a > 0) && (blobs->runs[a - 1].y == y - 1)) a--;
+        while ((b < nruns) && (blobs->runs[b].y == y)) b++;
+
+        int p = a;
+        for (int q = r0; q < b; q++)
+        {
+            const RVC *run = &blobs->runs[q];
+            while ((p < r0) && (blobs->runs[p].x2 < run->x1 - 1)) p++;
+            for (int k = p; (k < r0) && (blobs->runs[k].x1 <= run->x2 + 1); k++)
+                vc_uf_union_atomic(blobs->parent, blobs->runs[k].label, run->label);
+        }
+    }
+
+    return vc_blob_resolve(blobs);
+}
+#endif
+
+// Função para etiquetar as regiões brancas de uma imagem binária (conectividade 8)
+// A imagem é percorrida uma única vez, por sequências (runs); área, caixa e momentos
+// são acumulados por etiqueta nessa mesma passagem. Os blobs ficam numerados pela ordem
+// do seu primeiro pixel em varrimento raster. Com vc_threads_set(n > 1) e OpenMP, a imagem
+// é etiquetada em n faixas em paralelo, com resultado idêntico. Devolve o número de blobs
+// (-1 em caso de erro).
+int vc_binary_blob_labelling(IVC* src, BVC* blobs)
+{
+    if ((src == NULL) || (blobs == NULL) || (src->channels != 1)) return -1;
+
+    blobs->nruns = 0;
+    blobs->nblobs = 0;
+    blobs->nprovisional = 0;
+
+#ifdef _OPENMP
+    // Faixas de pelo menos 64 linhas
+    int nstrips = (vc_num_threads < src->height / 64) ? vc_num_threads : src->height / 64;
+    if (nstrips > 1) return vc_blob_label_strips(src, blobs, nstrips);
+#endif
+
+    if (!vc_blob_label_rows(src, 0, src->height, blobs)) return -1;
+
+    return vc_blob_resolve(blobs);
+}
+
+//++++ PREENCHIMENTO DE BURACOS ++++
+// O fundo ligado à margem é inundado a partir da margem, sequência a sequência (scanline): cada
+// sequência horizontal de fundo é marcada de uma vez e só as sequências vizinhas vão para a pilha.
+// Os píxeis alcançados ficam temporariamente a 1; no fim, numa passagem, o fundo não alcançado (0)
+// passa a 255 e o alcançado volta a 0. O fundo usa conectividade 4 (dual da 8 das regiões).
+
+typedef struct {
+    int y, x1, x2;
+} vc_holes_span;
+
+// Função para marcar a sequência de fundo que contém x e empilhá-la
+static int vc_holes_push(unsigned char *row, int x, int y, int xmin, int xmax,
+                        vc_holes_span **pilha, int *n, int *capacidade)
+{
+    int x1 = x, x2 = x;
+    while ((x1 > xmin) && (row[x1 - 1] == 0)) x1--;
+    while ((x2 < xmax) && (row[x2 + 1] == 0)) x2++;
+    memset(&row[x1], 1, x2 - x1 + 1);
+
+    if (!vc_grow((void **) pilha, capacidade, *n + 1, sizeof(vc_holes_span))) return -1;
+    (*pilha)[*n].y = y;
+    (*pilha)[*n].x1 = x1;
+    (*pilha)[*n].x2 = x2;
+    (*n)++;
+
+    return x2;
+}
+
+// Função para preencher os buracos das regiões dentro de um retângulo (a margem do retângulo
+// conta como exterior); imagem binária 0/255, alterada no lugar
+int vc_binary_fill_holes_roi(IVC *srcdst, int x, int y, int width, int height)
+{
+    if ((srcdst == NULL) || (srcdst->channels != 1)) return 0;
+    if ((x < 0) || (y < 0) || (width <= 0) || (height <= 0) ||
+        (x + width > srcdst->width) || (y + height > srcdst->height)) return 0;
+
+    int xmin = x, xmax = x + width - 1, ymin = y, ymax = y + height - 1;
+    vc_holes_span *pilha = NULL;
+    int n = 0, capacidade = 0, ok = 1;
+
+    // Sementes: o fundo nas margens superior e inferior (linhas inteiras) e nas margens laterais
+    for (int yy = ymin; (yy <= ymax) && ok; yy++)
+    {
+        unsigned char *row = &srcdst->data[yy * srcdst->bytesperline];
+
+        if ((yy == ymin) || (yy == ymax))
+        {
+            for (int xx = xmin; (xx <= xmax) && ok; xx++)
+            {
+                if (row[xx] != 0) continue;
+                int fim = vc_holes_push(row, xx, yy, xmin, xmax, &pilha, &n, &capacidade);
+                if (fim < 0) ok = 0;
+                else xx = fim;
+            }
+        }
+        else
+        {
+            if ((row[xmin] == 0) && (vc_holes_push(row, xmin, yy, xmin, xmax, &pilha, &n, &capacidade) < 0)) ok = 0;
+            if (ok && (row[xmax] == 0) && (vc_holes_push(row, xmax, yy, xmin, xmax, &pilha, &n, &capacidade) < 0)) ok = 0;
+        }
+    }
+
+    // Inundação: as sequências das linhas vizinhas que tocam cada sequência (conectividade 4)
+    while ((n > 0) && ok)
+    {
+        vc_holes_span s = pilha[--n];
+
+        for (int ny = s.y - 1; ny <= s.y + 1; ny += 2)
+        {
+            if ((ny < ymin) || (ny > ymax)) continue;
+            unsigned char *row = &srcdst->data[ny * srcdst->bytesperline];
+
+            for (int xx = s.x1; (xx <= s.x2) && ok; xx++)
+            {
+                if (row[xx] != 0) continue;
+                int fim = vc_holes_push(row, xx, ny, xmin, xmax, &pilha, &n, &capacidade);
+                if (fim < 0) ok = 0;
+                else xx = fim;
+            }
+        }
+    }
+
+    free(pilha);
+
+    // Buracos (fundo não alcançado) a 255; fundo alcançado de volta a 0
+    for (int yy = ymin; yy <= ymax; yy++)
+    {
+        unsigned char *row = &srcdst->data[yy * srcdst->bytesperline];
+        for (int xx = xmin; xx <= xmax; xx++)
+            row[xx] = (row[xx] == 0) ? (ok ? 255 : 0) : ((row[xx] == 1) ? 0 : row[xx]);
+    }
+
+#ifdef VC_DEBUG
+    if (!ok) vc_log(VC_LOG_ERRO, "ERROR -> vc_binary_fill_holes_roi():\n\tOut of memory!\n");
+#endif
+
+    return ok;
+}
+
+// Função para preencher os buracos das regiões de uma imagem binária (src pode ser igual a dst)
+int vc_binary_fill_holes(IVC *src, IVC *dst)
+{
+    if ((src == NULL) || (dst == NULL)) return 0;
+    if ((src->width != dst->width) || (src->height != dst->height) || (src->channels != 1) || (dst->channels != 1)) return 0;
+
+    if (src->data != dst->data)
+        for (int y = 0; y < src->height; y++)
+            memcpy(&dst->data[y * dst->bytesperline], &src->data[y * src->bytesperline], src->width);
+
+    return vc_binary_fill_holes_roi(dst, 0, 0, dst->width, dst->height);
+}
+
+//++++ ESTATÍSTICAS DE COR POR BLOB ++++
+// Cada blob é percorrido só nas suas sequências (runs) da etiquetagem, pelo que o custo é proporcional à
+// área das regiões e não ao tamanho da imagem. Cada sequência é cortada analiticamente nos círculos de
+// raio inner e outer (frações do raio equivalente, centrados no centro de massa) em até cinco troços:
+// exterior, intermédio, interior, intermédio, exterior. As somas de cada troço são acumuladas em blocos
+// de 16 píxeis pelo kernel vc_color_sum48 e as somas HSV da sequência inteira pelo vc_hsv_sums (ambos
+// escolhidos no arranque e vetorizados pelo compilador).
+
+// Somas de uma zona de um blob: por posição num bloco de 16 píxeis (canal j % 3) e nos píxeis soltos
+typedef struct {
+    unsigned int lsum[48], lsq[48];
+    int nblocks;                    // Blocos nas somas por posição (esvaziadas antes de transbordar)
+    long long sum[3], sq[3];
+    int n;
+} vc_color_acc;
+
+// Função para passar as somas por posição para as somas por canal
+static void vc_color_acc_flush(vc_color_acc *acc)
+{
+    for (int j = 0; j < 48; j++)
+    {
+        acc->sum[j % 3] += acc->lsum[j];
+        acc->sq[j % 3] += acc->lsq[j];
+        acc->lsum[j] = 0;
+        acc->lsq[j] = 0;
+    }
+    acc->nblocks = 0;
+}
+
+// Função para acumular n píxeis BGR seguidos
+// Os blocos começam sempre num píxel, logo a posição j de qualquer bloco é do canal j % 3
+static void vc_color_acc_add(const unsigned char *p, int n, vc_color_acc *acc)
+{
+    int nblocks = n / 16;
+
+    // Cada posição recebe até 65025 por bloco no quadrado: esvaziar antes dos 2^32
+    if (acc->nblocks + nblocks > 65000) vc_color_acc_flush(acc);
+    if (nblocks > 0) vc_kernels.color_sum48(p, nblocks, acc->lsum, acc->lsq);
+    acc->nblocks += nblocks;
+
+    for (int i = nblocks * 16; i < n; i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            unsigned int v = p[3 * i + c];
+            acc->sum[c] += v;
+            acc->sq[c] += v * v;
+        }
+    }
+    acc->n += n;
+}
+
+// Função para obter o intervalo [a, b] de colunas de uma linha dentro de um círculo (vazio se a > b)
+static void vc_disc_span(double cx, double dy, double radius, int *a, int *b)
+{
+    double w = radius * radius - dy * dy;
+
+    if (w < 0.0)
+    {
+        *a = 1;
+        *b = 0;
+        return;
+    }
+    w = sqrt(w);
+    *a = (int) ceil(cx - w);
+    *b = (int) floor(cx + w);
+}
+
+// Função para calcular as estatísticas de cor de cada blob etiquetado numa imagem BGR
+// As sequências são deslocadas de (dx, dy) (blobs etiquetados num recorte da imagem); só são
+// medidos os blobs com área > min_area (os restantes ficam a zero).
+// inner e outer: raios do disco interior e do início do anel exterior, em frações do raio equivalente
+// (0 <= inner <= outer). stats tem blobs->nblobs posições.
+int vc_blobs_color_stats(IVC *image, BVC *blobs, int dx, int dy, int min_area, float inner, float outer, EVC *stats)
+{
+    if ((image == NULL) || (blobs == NULL) || (stats == NULL)) return 0;
+    if ((image->channels != 3) || (inner < 0.0f) || (outer < inner)) return 0;
+    if (blobs->nblobs == 0) return 1;
+
+    vc_color_acc *acc = (vc_color_acc *) calloc((size_t) blobs->nblobs * 3, sizeof(vc_color_acc));
+    long long *hsv = (long long *) calloc((size_t) blobs->nblobs * 6, sizeof(long long));
+
+    if ((acc == NULL) || (hsv == NULL))
+    {
+#ifdef VC_DEBUG
+        vc_log(VC_LOG_ERRO, "ERROR -> vc_blobs_color_stats():\n\tOut of memory!\n");
+#endif
+        free(acc);
+        free(hsv);
+        return 0;
+    }
+
+    if (vc_kernels.level < 0) vc_cpu_init();
+
+    for (int i = 0; i < blobs->nruns; i++)
+    {
+        const RVC *run = &blobs->runs[i];
+        const OVC *blob = &blobs->blobs[run->label - 1];
+        int y = run->y + dy, x1 = run->x1 + dx, x2 = run->x2 + dx;
+
+        if (blob->area <= min_area) continue;
+        if ((y < 0) || (y >= image->height)) continue;
+        if (x1 < 0) x1 = 0;
+        if (x2 >= image->width) x2 = image->width - 1;
+        if (x1 > x2) continue;
+
+        // Zonas: 0 = interior, 1 = intermédia, 2 = exterior
+        vc_color_acc *z = &acc[(size_t) (run->label - 1) * 3];
+        const unsigned char *row = &image->data[(size_t) y * image->bytesperline];
+        double radius = blob->diameter / 2.0, cx = blob->cx + dx, ry = (double) y - (blob->cy + dy);
+        int ain, bin, aout, bout;
+
+        vc_disc_span(cx, ry, outer * radius, &aout, &bout);
+        vc_disc_span(cx, ry, inner * radius, &ain, &bin);
+
+        // Intervalos vazios colocados de modo a que os cinco troços fiquem seguidos e sem sobreposição
+        if (aout > bout)
+        {
+            aout = x2 + 1;
+            bout = x2;
+        }
+        if (ain > bin)
+        {
+            ain = aout;
+            bin = aout - 1;
+        }
+
+        const int corte[6] = { x1, aout, ain, bin + 1, bout + 1, x2 + 1 };
+        static const int zona[5] = { 2, 1, 0, 1, 2 };
+        for (int k = 0; k < 5; k++)
+        {
+            int a = (corte[k] > x1) ? corte[k] : x1;
+            int b = (corte[k + 1] - 1 < x2) ? (corte[k + 1] - 1) : x2;
+            if (a <= b) vc_color_acc_add(&row[a * 3], b - a + 1, &z[zona[k]]);
+        }
+
+        vc_kernels.hsv_sums(&row[x1 * 3], x2 - x1 + 1, vc_hue_cos, vc_hue_sin, &hsv[(size_t) (run->label - 1) * 6]);
+    }
+
+    for (int k = 0; k < blobs->nblobs; k++)
+    {
+        vc_color_acc *z = &acc[(size_t) k * 3];
+        const long long *h = &hsv[(size_t) k * 6];
+        EVC *e = &stats[k];
+        int n = z[0].n + z[1].n + z[2].n;
+
+        for (int j = 0; j < 3; j++) vc_color_acc_flush(&z[j]);
+
+        memset(e, 0, sizeof(EVC));
+        e->area = n;
+        e->inner_n = z[0].n;
+        e->outer_n = z[2].n;
+        if (n == 0) continue;
+
+        for (int c = 0; c < 3; c++)
+        {
+            double sum = (double) (z[0].sum[c] + z[1].sum[c] + z[2].sum[c]);
+            double sq = (double) (z[0].sq[c] + z[1].sq[c] + z[2].sq[c]);
+            e->mean[c] = (float) (sum / n);
+            e->var[c] = (float) fmax(sq / n - (sum / n) * (sum / n), 0.0);
+            if (z[0].n > 0) e->inner_mean[c] = (float) ((double) z[0].sum[c] / z[0].n);
+            if (z[2].n > 0) e->outer_mean[c] = (float) ((double) z[2].sum[c] / z[2].n);
+        }
+
+        // Matiz: média circular pesada pela saturação (o peso total é a soma de S)
+        if (h[2] > 0)
+        {
+            double hc = (double) h[0], hs = (double) h[1];
+            double hue = atan2(hs, hc) * 180.0 / 3.14159265358979323846;
+            e->hsv_mean[0] = (float) ((hue < 0.0) ? hue + 360.0 : hue);
+            e->hsv_var[0] = (float) fmax(1.0 - sqrt(hc * hc + hs * hs) / (16384.0 * h[2]), 0.0);
+        }
+        for (int c = 1; c < 3; c++)
+        {
+            double mean = (double) h[2 * c] / n;
+            e->hsv_mean[c] = (float) mean;
+            e->hsv_var[c] = (float) fmax((double) h[2 * c + 1] / n - mean * mean, 0.0);
+        }
+    }
+
+    free(acc);
+    free(hsv);
+
+    return 1;
+}
+
+// Função para classificar n amostras pelo centróide mais próximo (distância euclidiana ponderada)
+// features[f][i]: característica f da amostra i (estrutura de arrays)
+// scales[f], weights[f]: calibração e peso de cada característica (NULL = 1)
+// centroids[c * nfeatures + f]: centróide da classe c
+// Em caso de empate fica a classe de índice maior (limiares "área < limite" das tabelas por intervalos).
+// São classificadas 4 amostras de cada vez com SSE2.
+int vc_classify_nearest_centroid(const float* const* features, int nfeatures, int n, const float* scales, const float* weights,
+                                 const float* centroids, int nclasses, int* classes)
+{
+    if ((features == NULL) || (centroids == NULL) || (classes == NULL)) return 0;
+    if ((nfeatures <= 0) || (nclasses <= 0) || (n < 0)) return 0;
+
+    int i = 0;
+
+#ifdef VC_SSE2
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128 best = _mm_set1_ps(3.4e38f);
+        __m128i bestclass = _mm_setzero_si128();
+
+        for (int c = 0; c < nclasses; c++)
+        {
+            __m128 d = _mm_setzero_ps();
+            for (int f = 0; f < nfeatures; f++)
+            {
+                __m128 x = _mm_loadu_ps(&features[f][i]);
+                if (scales != NULL) x = _mm_mul_ps(x, _mm_set1_ps(scales[f]));
+                __m128 diff = _mm_sub_ps(x, _mm_set1_ps(centroids[c * nfeatures + f]));
+                __m128 sq = _mm_mul_ps(diff, diff);
+                if (weights != NULL) sq = _mm_mul_ps(sq, _mm_set1_ps(weights[f]));
+                d = _mm_add_ps(d, sq);
+            }
+
+            __m128i mask = _mm_castps_si128(_mm_cmple_ps(d, best));
+            best = _mm_min_ps(d, best);
+            bestclass = _mm_or_si128(_mm_and_si128(mask, _mm_set1_epi32(c)), _mm_andnot_si128(mask, bestclass));
+        }
+
+        _mm_storeu_si128((__m128i *) &classes[i], bestclass);
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        float best = 3.4e38f;
+        int bestclass = 0;
+
+        for (int c = 0; c < nclasses; c++)
+        {
+            float d = 0.0f;
+            for (int f = 0; f < nfeatures; f++)
+            {
+                float x = features[f][i];
+                if (scales != NULL) x = x * scales[f];
+                float diff = x - centroids[c * nfeatures + f];
+                float sq = diff * diff;
+                if (weights != NULL) sq = sq * weights[f];
+                d = d + sq;
+            }
+
+            if (d <= best)
+            {
+                best = d;
+                bestclass = c;
+            }
+        }
+
+        classes[i] = bestclass;
+    }
+
+    return 1;
+}
+
+// Preenche count pixels seguidos com a cor (copia o primeiro pixel em blocos que duplicam)
+static void vc_fill_span(unsigned char *p, int count, int channels, const unsigned char *color)
+{
+    if (count <= 0) return;
+
+    if (channels == 1)
+    {
+        memset(p, color[0], count);
+        return;
+    }
+
+    int total = count * channels;
+    int filled = channels;
+    memcpy(p, color, channels);
+    while (filled < total)
+    {
+        int n = (filled < total - filled) ? filled : total - filled;
+        memcpy(p + filled, p, n);
+        filled += n;
+    }
+}
+
+// Segmento horizontal [x1, x2] na linha y, recortado
+static void vc_draw_hspan(IVC *image, int x1, int x2, int y, const unsigned char *color)
+{
+    if ((y < 0) || (y >= image->height)) return;
+    if (x1 < 0) x1 = 0;
+    if (x2 >= image->width) x2 = image->width - 1;
+    if (x1 > x2) return;
+
+    vc_fill_span(&image->data[y * image->bytesperline + x1 * image->channels], x2 - x1 + 1, image->channels, color);
+}
+
+// Segmento vertical [y1, y2] na coluna x, recortado
+static void vc_draw_vspan(IVC *image, int x, int y1, int y2, const unsigned char *color)
+{
+    if ((x < 0) || (x >= image->width)) return;
+    if (y1 < 0) y1 = 0;
+    if (y2 >= image->height) y2 = image->height - 1;
+
+    unsigned char *p = &image->data[y1 * image->bytesperline + x * image->channels];
+    for (int y = y1; y <= y2; y++, p += image->bytesperline)
+        memcpy(p, color, image->channels);
+}
+
+// Pixel isolado, recortado
+static inline void vc_draw_pixel(IVC *image, int x, int y, const unsigned char *color)
+{
+    if ((x >= 0) && (x < image->width) && (y >= 0) && (y < image->height))
+        memcpy(&image->data[y * image->bytesperline + x * image->channels], color, image->channels);
+}
+
+// Função para desenhar o contorno de um retângulo (x1, y1)-(x2, y2), inclusive
+int vc_draw_rect(IVC* image, int x1, int y1, int x2, int y2, const unsigned char* color)
+{
+    if ((image == NULL) || (color == NULL)) return 0;
+    if ((x1 > x2) || (y1 > y2)) return 0;
+
+    vc_draw_hspan(image, x1, x2, y1, color);
+    vc_draw_hspan(image, x1, x2, y2, color);
+    vc_draw_vspan(image, x1, y1 + 1, y2 - 1, color);
+    vc_draw_vspan(image, x2, y1 + 1, y2 - 1, color);
+
+    return 1;
+}
+
+// Função para desenhar um marcador em cruz centrado em (x, y), com braços de size pixels (0 = só o pixel)
+int vc_draw_marker(IVC* image, int x, int y, int size, const unsigned char* color)
+{
+    if ((image == NULL) || (color == NULL) || (size < 0)) return 0;
+
+    vc_draw_hspan(image, x - size, x + size, y, color);
+    vc_draw_vspan(image, x, y - size, y - 1, color);
+    vc_draw_vspan(image, x, y + 1, y + size, color);
+
+    return 1;
+}
+
+// Função para desenhar uma circunferência (algoritmo do ponto médio)
+int vc_draw_circle(IVC* image, int xc, int yc, int radius, const unsigned char* color)
+{
+    if ((image == NULL) || (color == NULL) || (radius < 0)) return 0;
+
+    // Totalmente fora da imagem
+    if ((xc + radius < 0) || (xc - radius >= image->width) || (yc + radius < 0) || (yc - radius >= image->height)) return 1;
+
+    int x = radius, y = 0;
+    int err = 1 - radius;
+
+    while (x >= y)
+    {
+        vc_draw_pixel(image, xc + x, yc + y, color);
+        vc_draw_pixel(image, xc - x, yc + y, color);
+        vc_draw_pixel(image, xc + x, yc - y, color);
+        vc_draw_pixel(image, xc - x, yc - y, color);
+        vc_draw_pixel(image, xc + y, yc + x, color);
+        vc_draw_pixel(image, xc - y, yc + x, color);
+        vc_draw_pixel(image, xc + y, yc - x, color);
+        vc_draw_pixel(image, xc - y, yc - x, color);
+
+        y++;
+        if (err < 0)
+        {
+            err += 2 * y + 1;
+        }
+        else
+        {
+            x--;
+            err += 2 * (y - x) + 1;
+        }
+    }
+
+    return 1;
+}
+
+// Função para desenhar todas as deteções de uma vez (arrays com n elementos)
+// Caixas (x1, y1)-(x2, y2) com boxcolor; marcador em (xc, yc) com markercolor;
+// se radius != NULL desenha também a circunferência de cada deteção com boxcolor.
+int vc_draw_detections(IVC* image, int n, const int* x1, const int* y1, const int* x2, const int* y2,
+                       const int* xc, const int* yc, const float* radius,
+                       const unsigned char* boxcolor, const unsigned char* markercolor, int markersize)
+{
+    if ((image == NULL) || (n < 0)) return 0;
+
+    if ((x1 != NULL) && (y1 != NULL) && (x2 != NULL) && (y2 != NULL) && (boxcolor != NULL))
+    {
+        for (int i = 0; i < n; i++)
+            vc_draw_rect(image, x1[i], y1[i], x2[i], y2[i], boxcolor);
+    }
+
+    if ((xc != NULL) && (yc != NULL))
+    {
+        if ((radius != NULL) && (boxcolor != NULL))
+        {
+            for (int i = 0; i < n; i++)
+                vc_draw_circle(image, xc[i], yc[i], (int) (radius[i] + 0.5f), boxcolor);
+        }
+
+        if (markercolor != NULL)
+        {
+            for (int i = 0; i < n; i++)
+                vc_draw_marker(image, xc[i], yc[i], markersize, markercolor);
+        }
+    }
+
+    return 1;
+}
+
+// Função para criar um sprite a partir de uma imagem BGRA (4 canais)
+SVC* vc_sprite_new(IVC* bgra)
+{
+    if ((bgra == NULL) || (bgra->channels != 4)) return NULL;
+
+    SVC *sprite = (SVC *) malloc(sizeof(SVC));
+    if (sprite == NULL) return NULL;
+
+    sprite->color = vc_image_new(bgra->width, bgra->height, 3, 255);
+    sprite->transparency = vc_image_new(bgra->width, bgra->height, 3, 255);
+    if ((sprite->color == NULL) || (sprite->transparency == NULL)) return vc_sprite_free(sprite);
+
+    for (int y = 0; y < bgra->height; y++)
+    {
+        const unsigned char *src = &bgra->data[y * bgra->bytesperline];
+        unsigned char *color = &sprite->color->data[y * sprite->color->bytesperline];
+        unsigned char *transparency = &sprite->transparency->data[y * sprite->transparency->bytesperline];
+
+        for (int x = 0; x < bgra->width; x++, src += 4, color += 3, transparency += 3)
+        {
+            int a = src[3];
+            for (int c = 0; c < 3; c++)
+            {
+                color[c] = (unsigned char) ((src[c] * a + 127) / 255);
+                transparency[c] = (unsigned char) (255 - a);
+            }
+        }
+    }
+
+    return sprite;
+}
+
+// Função para libertar a memória de um sprite
+SVC* vc_sprite_free(SVC* sprite)
+{
+    if (sprite != NULL)
+    {
+        vc_image_free(sprite->color);
+        vc_image_free(sprite->transparency);
+        free(sprite);
+    }
+
+    return NULL;
+}
+
+// Função para sobrepor um sprite a uma imagem BGR na posição (x, y), recortado às margens
+// dst = cor + dst * transparência / 255; como as duas imagens do sprite têm a disposição BGR
+// do destino, cada linha é uma operação byte a byte (16 bytes por passo com SSE2)
+int vc_sprite_blit(IVC* dst, SVC* sprite, int x, int y)
+{
+    if ((dst == NULL) || (sprite == NULL) || (dst->channels != 3)) return 0;
+
+    int sx = 0, sy = 0;
+    int width = sprite->color->width, height = sprite->color->height;
+
+    if (x < 0) { sx = -x; width += x; x = 0; }
+    if (y < 0) { sy = -y; height += y; y = 0; }
+    if (x + width > dst->width) width = dst->width - x;
+    if (y + height > dst->height) height = dst->height - y;
+    if ((width <= 0) || (height <= 0)) return 1;
+
+    int len = width * 3;
+
+    for (int j = 0; j < height; j++)
+    {
+        unsigned char *d = &dst->data[(y + j) * dst->bytesperline + x * 3];
+        const unsigned char *c = &sprite->color->data[(sy + j) * sprite->color->bytesperline + sx * 3];
+        const unsigned char *t = &sprite->transparency->data[(sy + j) * sprite->transparency->bytesperline + sx * 3];
+        int i = 0;
+
+#ifdef VC_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i round = _mm_set1_epi16(128);
+        for (; i + 16 <= len; i += 16)
+        {
+            __m128i vd = _mm_loadu_si128((const __m128i *) &d[i]);
+            __m128i vt = _mm_loadu_si128((const __m128i *) &t[i]);
+            __m128i vc = _mm_loadu_si128((const __m128i *) &c[i]);
+
+            // d * t / 255 com arredondamento: (p + 128 + ((p + 128) >> 8)) >> 8
+            __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(vd, zero), _mm_unpacklo_epi8(vt, zero)), round);
+            __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(vd, zero), _mm_unpackhi_epi8(vt, zero)), round);
+            lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+            hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+
+            _mm_storeu_si128((__m128i *) &d[i], _mm_adds_epu8(_mm_packus_epi16(lo, hi), vc));
+        }
+#endif
+        for (; i < len; i++)
+        {
+            int p = d[i] * t[i] + 128;
+            int v = c[i] + ((p + (p >> 8)) >> 8);
+            d[i] = (unsigned char) ((v > 255) ? 255 : v);
         }
     }
 
@@ -1,6 +1,9 @@
 #ifndef VC_H
 #define VC_H
 
+#include <stdio.h>
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -18,18 +21,109 @@ typedef struct {
     int bytesperline;   // width * channels
 } IVC;
 
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//                   ESTRUTURA DE UM CONTORNO
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+typedef struct {
+    int *x, *y;             // Pontos do contorno (pixels da fronteira)
+    unsigned char *chain;   // Código de cadeia de Freeman (0=E, 1=NE, 2=N, ... 7=SE)
+    int npoints;            // Número de pontos (igual ao número de códigos)
+    int capacity;           // Capacidade alocada
+    double perimeter;       // Perímetro (passos pares = 1, passos ímpares = sqrt(2))
+} CVC;
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//              ESTRUTURA DE UM SPRITE (SOBREPOSIÇÃO)
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// Sprite BGRA preparado para sobrepor a imagens BGR: cor pré-multiplicada pelo alfa
+// e transparência (255 - alfa) repetida por canal, ambas com a disposição BGR do destino
+typedef struct {
+    IVC *color;             // B*a, G*a, R*a (/255)
+    IVC *transparency;      // 255 - a, em cada canal
+} SVC;
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//              ESTRUTURAS DA ETIQUETAGEM DE BLOBS
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// Sequência horizontal de pixels brancos (run)
+typedef struct {
+    int y, x1, x2;          // Linha e colunas inicial/final (inclusive)
+    int label;              // Etiqueta do blob
+} RVC;
+
+// Blob: características acumuladas durante a etiquetagem
+typedef struct {
+    int x, y, width, height;        // Caixa delimitadora
+    int area;                       // Área (m00)
+    int xc, yc;                     // Centro de massa (arredondado)
+    double cx, cy;                  // Centro de massa
+    int label;                      // Etiqueta (1..nblobs)
+    int xstart, ystart;             // Primeiro pixel em varrimento raster (início do contorno)
+    long long m10, m01, m20, m11, m02, m30, m21, m12, m03; // Momentos brutos
+    double mu20, mu11, mu02, mu30, mu21, mu12, mu03;       // Momentos centrais
+    double hu[7];                   // Momentos invariantes de Hu
+    double eccentricity;            // Excentricidade da elipse equivalente (0 = círculo)
+    double orientation;             // Orientação do eixo maior (radianos)
+    double diameter;                // Diâmetro equivalente sqrt(4 * área / pi)
+} OVC;
+
+// Contexto da etiquetagem (reutilizável entre frames, cresce quando necessário)
+typedef struct vc_blobs {
+    RVC *runs;                      // Sequências da imagem, em varrimento raster
+    int nruns, runs_capacity;
+    OVC *blobs;                     // Blobs encontrados (blobs[i].label == i + 1)
+    int nblobs, blobs_capacity;
+    int *parent;                    // Union-find das etiquetas provisórias
+    struct vc_blob_acc *acc;        // Acumuladores das etiquetas provisórias
+    int nprovisional, parent_capacity, acc_capacity;
+    struct vc_blobs *strips;        // Faixas da etiquetagem paralela (só sequências e acumuladores)
+    int strips_capacity;
+} BVC;
+
+// Estatísticas de cor de um blob (canais pela ordem da imagem: BGR nos frames do OpenCV)
+typedef struct {
+    int area;                       // Píxeis medidos
+    float mean[3], var[3];          // Média e variância de cada canal
+    float hsv_mean[3];              // Matiz (graus, média circular pesada pela saturação), S e V (0..255)
+    float hsv_var[3];               // Variância circular da matiz (0..1) e variâncias de S e V
+    int inner_n, outer_n;           // Píxeis do disco interior e do anel exterior
+    float inner_mean[3];            // Cor média do disco interior
+    float outer_mean[3];            // Cor média do anel exterior
+} EVC;
+
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 //                    PROTÓTIPOS DE FUNÇÕES
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
+// FUNÇÕES: DESPACHO POR CPU (variantes dos kernels escolhidas no arranque; VC_CPU força um nível)
+#define VC_CPU_SCALAR 0
+#define VC_CPU_SSE41 1
+#define VC_CPU_AVX2 2
+#define VC_CPU_AVX512 3
+int vc_cpu_init(void);
+int vc_cpu_level(void);
+const char* vc_cpu_level_name(int level);
+
+// FUNÇÕES: PARALELISMO (número de threads das funções de vc.c que dividem a imagem; requer OpenMP)
+void vc_threads_set(int n);
+int vc_threads_get(void);
+
 // FUNÇÕES: ALOCAR E LIBERTAR UMA IMAGEM
 IVC* vc_image_new(int width, int height, int channels, int levels);
 IVC* vc_image_free(IVC* image);
+int vc_image_crop(IVC* src, IVC* dst, int x, int y);
 
 // FUNÇÕES: LEITURA E ESCRITA DE IMAGENS (PBM, PGM E PPM)
+char* netpbm_get_token(FILE* file, char* tok, int len);
 IVC* vc_read_image(char* filename);
 int vc_write_image(char* filename, IVC* image);
 
+// FUNÇÕES: LEITURA SEM CÓPIA (FICHEIROS MAPEADOS EM MEMÓRIA)
+void* vc_file_map(const char* filename, size_t* length);
+void vc_file_unmap(void* base, size_t length);
+IVC* vc_read_image_mapped(char* filename);
+IVC* vc_image_unmap(IVC* image);
+
 // FUNÇÕES: TRANSFORMAÇÕES DE IMAGENS
 int vc_gray_negative(IVC* srcdst);
 int vc_rgb_to_gray(IVC* src, IVC* dst);
@@ -47,9 +141,64 @@ int vc_gray_to_binary_global_mean(IVC* src, IVC* dst);
 int vc_gray_to_binary_adaptive_mean(IVC *src, IVC *dst, int kernel_size, int c);
 int vc_gray_gaussian_blur(IVC *src, IVC *dst);
 
+// FUNÇÕES: HISTOGRAMA E LIMIARES GLOBAIS (hist tem 256 posições; limiar t: píxeis > t ficam a 255)
+int vc_gray_histogram(IVC* src, unsigned int* hist);
+int vc_rgb_to_gray_histogram(IVC* src, IVC* dst, unsigned int* hist);
+int vc_histogram_otsu(const unsigned int* hist);
+int vc_histogram_percentile(const unsigned int* hist, float percent);
+int vc_gray_to_binary_otsu(IVC* src, IVC* dst);
+
+// FUNÇÕES: ETIQUETAGEM DE BLOBS (CONECTIVIDADE 8)
+BVC* vc_blobs_new(void);
+BVC* vc_blobs_free(BVC* blobs);
+int vc_binary_blob_labelling(IVC* src, BVC* blobs);
+
+// FUNÇÕES: CLASSIFICAÇÃO EM LOTE
+int vc_classify_nearest_centroid(const float* const* features, int nfeatures, int n, const float* scales, const float* weights,
+                                 const float* centroids, int nclasses, int* classes);
+
+// FUNÇÕES: DESENHO (RECORTADO ÀS MARGENS DA IMAGEM; color TEM image->channels BYTES)
+int vc_draw_rect(IVC* image, int x1, int y1, int x2, int y2, const unsigned char* color);
+int vc_draw_marker(IVC* image, int x, int y, int size, const unsigned char* color);
+int vc_draw_circle(IVC* image, int xc, int yc, int radius, const unsigned char* color);
+int vc_draw_detections(IVC* image, int n, const int* x1, const int* y1, const int* x2, const int* y2,
+                       const int* xc, const int* yc, const float* radius,
+                       const unsigned char* boxcolor, const unsigned char* markercolor, int markersize);
+
+// FUNÇÕES: SPRITES (SOBREPOSIÇÃO COM TRANSPARÊNCIA)
+SVC* vc_sprite_new(IVC* bgra);
+SVC* vc_sprite_free(SVC* sprite);
+int vc_sprite_blit(IVC* dst, SVC* sprite, int x, int y);
+
+// FUNÇÕES: CONTORNOS
+CVC* vc_contour_new(void);
+CVC* vc_contour_free(CVC* contour);
+int vc_binary_contour_trace(IVC* src, int x, int y, CVC* contour);
+
+// FUNÇÕES: PIRÂMIDE (REDUÇÃO DE RESOLUÇÃO 2x / 4x)
+int vc_image_downscale(IVC *src, IVC *dst, int factor);
+
 // FUNÇÕES: OPERAÇÕES MORFOLÓGICAS
 int vc_binary_dilate(IVC* src, IVC* dst, int kernel_size);
 int vc_binary_erode(IVC* src, IVC* dst, int kernel_size);
+// Fecho e abertura numa só passagem (seguros com src == dst)
+int vc_binary_close(IVC* src, IVC* dst, int kernel_size);
+int vc_binary_open(IVC* src, IVC* dst, int kernel_size);
+
+// FUNÇÕES: TRANSFORMADA DE DISTÂNCIA (EUCLIDIANA EXATA; dst com width * height posições)
+int vc_binary_distance_transform(IVC* src, float* dst);
+int vc_binary_distance_transform_u16(IVC* src, unsigned short* dst);
+int vc_blobs_max_distance(BVC* blobs, const float* dist, int width, float* radius);
+
+// FUNÇÕES: SEPARAÇÃO DE REGIÕES QUE SE TOCAM (WATERSHED COM MARCADORES, NUMA REGIÃO DE CADA VEZ)
+int vc_binary_watershed_split(IVC* srcdst, float fraction);
+
+// FUNÇÕES: PREENCHIMENTO DE BURACOS (A MARGEM DA IMAGEM OU DO RETÂNGULO CONTA COMO EXTERIOR)
+int vc_binary_fill_holes(IVC* src, IVC* dst);
+int vc_binary_fill_holes_roi(IVC* srcdst, int x, int y, int width, int height);
+
+// FUNÇÕES: ESTATÍSTICAS DE COR POR BLOB (SÓ AS SEQUÊNCIAS DE CADA BLOB; stats COM blobs->nblobs POSIÇÕES)
+int vc_blobs_color_stats(IVC* image, BVC* blobs, int dx, int dy, int min_area, float inner, float outer, EVC* stats);
 
 #ifdef __cplusplus
 }
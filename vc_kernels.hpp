@@ -0,0 +1,303 @@
+#ifndef VC_KERNELS_HPP
+#define VC_KERNELS_HPP
+
+#include <vector>
+#include <stdint.h>
+
+extern "C" {
+#include "vc.h"
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//        KERNELS ESPECIALIZADOS EM TEMPO DE COMPILAÇÃO
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// Versões em template (raio, canais, política de margem) dos filtros de vc.c: com o raio
+// fixo, os ciclos interiores têm número de iterações constante e o compilador desenrola-os
+// e vetoriza-os. As funções de despacho escolhem a instância pelo tamanho pedido e usam a
+// implementação em C de vc.c para os restantes tamanhos.
+
+namespace vc {
+
+// Política para os píxeis cuja vizinhança sai da imagem
+enum class Borda {
+    Interior,   // Não são calculados (ficam como estavam no destino), como em vc.c
+    Replicar    // A vizinhança usa o píxel da margem mais próximo
+};
+
+//++++ PESOS GAUSSIANOS (GERADOS EM TEMPO DE COMPILAÇÃO) ++++
+
+// exp(x) para x <= 0, avaliável em tempo de compilação (std::exp não é constexpr)
+constexpr double exp_constexpr(double x) {
+    // e^x = (e^(x / 1024))^1024, com a série de Taylor para o argumento pequeno
+    double y = x / 1024.0, termo = 1.0, soma = 1.0;
+    for (int n = 1; n < 12; n++) {
+        termo *= y / n;
+        soma += termo;
+    }
+    for (int i = 0; i < 10; i++) soma *= soma;
+    return soma;
+}
+
+// Pesos 1D em vírgula fixa (somam exatamente 1 << BITS); sigma como no OpenCV para ksize = 2R + 1
+template <int R>
+struct PesosGaussianos {
+    static constexpr int BITS = 8;
+    int w[2 * R + 1];
+
+    constexpr PesosGaussianos() : w() {
+        const double sigma = 0.3 * (R - 1) + 0.8;
+        double g[2 * R + 1] = {};
+        double total = 0.0;
+        for (int k = -R; k <= R; k++) {
+            g[k + R] = exp_constexpr(-(double)(k * k) / (2.0 * sigma * sigma));
+            total += g[k + R];
+        }
+        int soma = 0;
+        for (int k = 0; k < 2 * R + 1; k++) {
+            w[k] = (int)(g[k] / total * (1 << BITS) + 0.5);
+            soma += w[k];
+        }
+        // O arredondamento fica no peso central
+        w[R] += (1 << BITS) - soma;
+    }
+};
+
+//++++ MORFOLOGIA BINÁRIA ++++
+
+// Dilatação (Dilatar = true) ou erosão com elemento estruturante quadrado (2R+1)x(2R+1).
+// Tal como em vc.c, só os píxeis a 255 contam como brancos e a vizinhança é recortada
+// à imagem. O elemento quadrado é separável: passagem vertical e depois horizontal.
+// src e dst têm de ser imagens diferentes.
+template <int R, bool Dilatar>
+int binary_morphology(const IVC* src, IVC* dst) {
+    static_assert(R >= 1, "raio inválido");
+
+    if (src == NULL || dst == NULL || src->data == dst->data) return 0;
+    if (src->width != dst->width || src->height != dst->height || src->channels != 1 || dst->channels != 1) return 0;
+
+    const int W = src->width, H = src->height;
+    const unsigned char neutro = Dilatar ? 0 : 255;
+    std::vector<unsigned char> coluna(W);
+
+    for (int y = 0; y < H; y++) {
+        unsigned char* c = coluna.data();
+
+        // Vertical: combinar as linhas y-R..y+R
+        if (y >= R && y + R < H) {
+            const unsigned char* p = &src->data[(y - R) * src->bytesperline];
+            for (int x = 0; x < W; x++) {
+                unsigned char v = neutro;
+                for (int k = 0; k < 2 * R + 1; k++) {
+                    unsigned char b = (p[k * src->bytesperline + x] == 255) ? 255 : 0;
+                    v = Dilatar ? (unsigned char)(v | b) : (unsigned char)(v & b);
+                }
+                c[x] = v;
+            }
+        } else {
+            int y0 = (y - R < 0) ? 0 : y - R;
+            int y1 = (y + R >= H) ? H - 1 : y + R;
+            for (int x = 0; x < W; x++) c[x] = neutro;
+            for (int yy = y0; yy <= y1; yy++) {
+                const unsigned char* p = &src->data[yy * src->bytesperline];
+                for (int x = 0; x < W; x++) {
+                    unsigned char b = (p[x] == 255) ? 255 : 0;
+                    c[x] = Dilatar ? (unsigned char)(c[x] | b) : (unsigned char)(c[x] & b);
+                }
+            }
+        }
+
+        // Horizontal: combinar as colunas x-R..x+R
+        unsigned char* out = &dst->data[y * dst->bytesperline];
+        for (int x = R; x < W - R; x++) {
+            unsigned char v = neutro;
+            for (int k = 0; k < 2 * R + 1; k++) v = Dilatar ? (unsigned char)(v | c[x - R + k]) : (unsigned char)(v & c[x - R + k]);
+            out[x] = v;
+        }
+        for (int x = 0; x < W; x++) {
+            if (x == R && W - R > R) x = W - R;
+            int x0 = (x - R < 0) ? 0 : x - R;
+            int x1 = (x + R >= W) ? W - 1 : x + R;
+            unsigned char v = neutro;
+            for (int xx = x0; xx <= x1; xx++) v = Dilatar ? (unsigned char)(v | c[xx]) : (unsigned char)(v & c[xx]);
+            out[x] = v;
+        }
+    }
+
+    return 1;
+}
+
+//++++ LIMIARIZAÇÃO ADAPTATIVA ++++
+
+// Igual a vc_gray_to_binary_adaptive_mean() com janela 2R+1: só os píxeis interiores são
+// escritos. As somas das colunas são atualizadas linha a linha (soma a linha que entra,
+// subtrai a que sai); a soma horizontal tem 2R+1 parcelas fixas e a divisão é por uma constante.
+template <int R>
+int gray_to_binary_adaptive_mean(const IVC* src, IVC* dst, int offset) {
+    static_assert(R >= 1, "raio inválido");
+    constexpr int N = 2 * R + 1;
+    constexpr int AREA = N * N;
+
+    if (src == NULL || dst == NULL) return 0;
+    if (src->width != dst->width || src->height != dst->height || src->channels != 1 || dst->channels != 1) return 0;
+
+    const int W = src->width, H = src->height;
+    if (W < N || H < N) return 1;
+
+    // Somas das colunas para as linhas 0..N-1
+    std::vector<int> colunas(W, 0);
+    int* s = colunas.data();
+    for (int k = 0; k < N; k++) {
+        const unsigned char* p = &src->data[k * src->bytesperline];
+        for (int x = 0; x < W; x++) s[x] += p[x];
+    }
+
+    for (int y = R; y < H - R; y++) {
+        if (y > R) {
+            const unsigned char* entra = &src->data[(y + R) * src->bytesperline];
+            const unsigned char* sai = &src->data[(y - R - 1) * src->bytesperline];
+            for (int x = 0; x < W; x++) s[x] += entra[x] - sai[x];
+        }
+
+        const unsigned char* p = &src->data[y * src->bytesperline];
+        unsigned char* out = &dst->data[y * dst->bytesperline];
+        for (int x = R; x < W - R; x++) {
+            int soma = 0;
+            for (int k = 0; k < N; k++) soma += s[x - R + k];
+            int media = soma / AREA;
+            out[x] = (p[x] < media - offset) ? 0 : 255;
+        }
+    }
+
+    return 1;
+}
+
+//++++ FILTRO GAUSSIANO ++++
+
+// Filtro gaussiano separável (2R+1)x(2R+1) com C canais intercalados, em vírgula fixa:
+// passagem vertical para um buffer de 16 bits e horizontal com arredondamento.
+template <int R, int C, Borda B>
+int gaussian_blur(const IVC* src, IVC* dst) {
+    static_assert(R >= 1, "raio inválido");
+    static_assert(C >= 1 && C <= 4, "número de canais inválido");
+    static constexpr PesosGaussianos<R> pesos{};
+    constexpr int BITS = 2 * PesosGaussianos<R>::BITS;
+    constexpr int N = 2 * R + 1;
+
+    if (src == NULL || dst == NULL || src->data == dst->data) return 0;
+    if (src->width != dst->width || src->height != dst->height || src->channels != C || dst->channels != C) return 0;
+
+    const int W = src->width, H = src->height;
+    if (B == Borda::Interior && (W < N || H < N)) return 1;
+
+    // Linha de somas verticais, com R posições replicadas de cada lado
+    std::vector<uint16_t> buffer((size_t)(W + 2 * R) * C);
+    uint16_t* v = buffer.data() + R * C;
+
+    const int yInicio = (B == Borda::Interior) ? R : 0;
+    const int yFim = (B == Borda::Interior) ? H - R : H;
+
+    for (int y = yInicio; y < yFim; y++) {
+        const unsigned char* linhas[N];
+        for (int k = 0; k < N; k++) {
+            int yy = y - R + k;
+            yy = (yy < 0) ? 0 : ((yy >= H) ? H - 1 : yy);
+            linhas[k] = &src->data[yy * src->bytesperline];
+        }
+
+        for (int i = 0; i < W * C; i++) {
+            int soma = 0;
+            for (int k = 0; k < N; k++) soma += pesos.w[k] * linhas[k][i];
+            v[i] = (uint16_t)soma;
+        }
+
+        if (B == Borda::Replicar) {
+            for (int k = 1; k <= R; k++) {
+                for (int c = 0; c < C; c++) {
+                    v[-k * C + c] = v[c];
+                    v[(W - 1 + k) * C + c] = v[(W - 1) * C + c];
+                }
+            }
+        }
+
+        unsigned char* out = &dst->data[y * dst->bytesperline];
+        const int xInicio = (B == Borda::Interior) ? R : 0;
+        const int xFim = (B == Borda::Interior) ? W - R : W;
+        for (int i = xInicio * C; i < xFim * C; i++) {
+            uint32_t soma = 0;
+            for (int k = 0; k < N; k++) soma += (uint32_t)pesos.w[k] * v[i + (k - R) * C];
+            out[i] = (unsigned char)((soma + (1u << (BITS - 1))) >> BITS);
+        }
+    }
+
+    return 1;
+}
+
+//++++ DESPACHO PELO TAMANHO EM TEMPO DE EXECUÇÃO ++++
+
+// Dilatação binária: instâncias para 3x3, 5x5 e 7x7; restantes tamanhos (e src == dst) em C
+inline int binary_dilate(IVC* src, IVC* dst, int kernel_size) {
+    if (src != NULL && dst != NULL && src->data != dst->data) {
+        switch (kernel_size) {
+            case 3: return binary_morphology<1, true>(src, dst);
+            case 5: return binary_morphology<2, true>(src, dst);
+            case 7: return binary_morphology<3, true>(src, dst);
+        }
+    }
+    return vc_binary_dilate(src, dst, kernel_size);
+}
+
+// Erosão binária: instâncias para 3x3, 5x5 e 7x7; restantes tamanhos (e src == dst) em C
+inline int binary_erode(IVC* src, IVC* dst, int kernel_size) {
+    if (src != NULL && dst != NULL && src->data != dst->data) {
+        switch (kernel_size) {
+            case 3: return binary_morphology<1, false>(src, dst);
+            case 5: return binary_morphology<2, false>(src, dst);
+            case 7: return binary_morphology<3, false>(src, dst);
+        }
+    }
+    return vc_binary_erode(src, dst, kernel_size);
+}
+
+// Limiarização adaptativa: instâncias para as janelas ímpares de 3 a 15; restantes em C
+inline int gray_to_binary_adaptive_mean(IVC* src, IVC* dst, int windowSize, int offset) {
+    switch (windowSize) {
+        case 3: return gray_to_binary_adaptive_mean<1>(src, dst, offset);
+        case 5: return gray_to_binary_adaptive_mean<2>(src, dst, offset);
+        case 7: return gray_to_binary_adaptive_mean<3>(src, dst, offset);
+        case 9: return gray_to_binary_adaptive_mean<4>(src, dst, offset);
+        case 11: return gray_to_binary_adaptive_mean<5>(src, dst, offset);
+        case 13: return gray_to_binary_adaptive_mean<6>(src, dst, offset);
+        case 15: return gray_to_binary_adaptive_mean<7>(src, dst, offset);
+    }
+    return vc_gray_to_binary_adaptive_mean(src, dst, windowSize, offset);
+}
+
+// Filtro gaussiano: raios 1 a 3, 1 ou 3 canais; por omissão a margem fica por calcular, como em vc.c.
+// Não há equivalente em C para outros tamanhos (vc_gray_gaussian_blur() é só 5x5): devolve 0.
+template <Borda B>
+inline int gaussian_blur(IVC* src, IVC* dst, int radius) {
+    if (src == NULL) return 0;
+    if (src->channels == 1) {
+        switch (radius) {
+            case 1: return gaussian_blur<1, 1, B>(src, dst);
+            case 2: return gaussian_blur<2, 1, B>(src, dst);
+            case 3: return gaussian_blur<3, 1, B>(src, dst);
+        }
+    } else if (src->channels == 3) {
+        switch (radius) {
+            case 1: return gaussian_blur<1, 3, B>(src, dst);
+            case 2: return gaussian_blur<2, 3, B>(src, dst);
+            case 3: return gaussian_blur<3, 3, B>(src, dst);
+        }
+    }
+    return 0;
+}
+
+inline int gaussian_blur(IVC* src, IVC* dst, int radius, Borda borda = Borda::Interior) {
+    if (borda == Borda::Replicar) return gaussian_blur<Borda::Replicar>(src, dst, radius);
+    return gaussian_blur<Borda::Interior>(src, dst, radius);
+}
+
+} // namespace vc
+
+#endif
@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "vc_log.h"
+
+namespace {
+
+const size_t CAPACIDADE = 1024;       // Potência de 2
+const size_t TAMANHO_MENSAGEM = 240;
+const int NUM_LIMITES = 64;
+
+// Posição do buffer circular (fila MPSC limitada, com números de sequência por posição)
+struct Posicao {
+    std::atomic<size_t> sequencia;
+    int nivel;
+    double tempo;
+    char mensagem[TAMANHO_MENSAGEM];
+};
+
+// Limite de mensagens por segundo, indexado pelo endereço do formato
+struct Limite {
+    std::atomic<const char*> formato{nullptr};
+    std::atomic<long long> segundo{-1};
+    std::atomic<int> contagem{0};
+};
+
+Posicao buffer[CAPACIDADE];
+std::atomic<size_t> posEscrita{0};
+size_t posLeitura = 0;                  // Só usada pela thread de escrita
+
+Limite limites[NUM_LIMITES];
+
+std::atomic<int> nivelAtivo{VC_LOG_INFO};
+std::atomic<bool> ativo{false};
+std::atomic<bool> parar{false};
+std::atomic<unsigned> descartadas{0};
+std::atomic<unsigned> suprimidas{0};
+std::thread escritor;
+
+const std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now();
+
+const char* nomes[] = { "ERRO", "AVISO", "INFO", "DEBUG" };
+
+double agora() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+}
+
+const char* nomeNivel(int nivel) {
+    return (nivel >= 0 && nivel <= VC_LOG_DEBUG) ? nomes[nivel] : "?";
+}
+
+void escreverDireto(int nivel, const char* fmt, va_list args) {
+    char mensagem[TAMANHO_MENSAGEM];
+    vsnprintf(mensagem, sizeof(mensagem), fmt, args);
+    printf("[%9.3f] %s: %s", agora(), nomeNivel(nivel), mensagem);
+}
+
+void registar(int nivel, const char* fmt, va_list args) {
+    if (!ativo.load(std::memory_order_acquire)) {
+        escreverDireto(nivel, fmt, args);
+        return;
+    }
+
+    // Reservar uma posição
+    size_t pos = posEscrita.load(std::memory_order_relaxed);
+    Posicao* p;
+    for (;;) {
+        p = &buffer[pos & (CAPACIDADE - 1)];
+        size_t seq = p->sequencia.load(std::memory_order_acquire);
+        intptr_t diferenca = (intptr_t)seq - (intptr_t)pos;
+        if (diferenca == 0) {
+            if (posEscrita.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diferenca < 0) {
+            // Buffer cheio: descartar
+            descartadas.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = posEscrita.load(std::memory_order_relaxed);
+        }
+    }
+
+    p->nivel = nivel;
+    p->tempo = agora();
+    vsnprintf(p->mensagem, TAMANHO_MENSAGEM, fmt, args);
+    p->sequencia.store(pos + 1, std::memory_order_release);
+}
+
+// Escreve todas as mensagens disponíveis; devolve o número escrito
+int esvaziar() {
+    int n = 0;
+    for (;;) {
+        Posicao* p = &buffer[posLeitura & (CAPACIDADE - 1)];
+        if (p->sequencia.load(std::memory_order_acquire) != posLeitura + 1) break;
+
+        printf("[%9.3f] %s: %s", p->tempo, nomeNivel(p->nivel), p->mensagem);
+        p->sequencia.store(posLeitura + CAPACIDADE, std::memory_order_release);
+        posLeitura++;
+        n++;
+    }
+
+    unsigned perdidas = descartadas.exchange(0, std::memory_order_relaxed);
+    if (perdidas > 0) {
+        printf("[%9.3f] %s: %u mensagens descartadas (buffer cheio)\n", agora(), nomeNivel(VC_LOG_AVISO), perdidas);
+        n++;
+    }
+
+    if (n > 0) fflush(stdout);
+    return n;
+}
+
+void executar() {
+    while (!parar.load(std::memory_order_acquire)) {
+        if (esvaziar() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    esvaziar();
+}
+
+} // namespace
+
+extern "C" void vc_log_start(int level) {
+    if (escritor.joinable()) return;
+
+    for (size_t i = 0; i < CAPACIDADE; i++) buffer[i].sequencia.store(i, std::memory_order_relaxed);
+    posEscrita.store(0, std::memory_order_relaxed);
+    posLeitura = 0;
+
+    nivelAtivo.store(level, std::memory_order_relaxed);
+    parar.store(false, std::memory_order_relaxed);
+    escritor = std::thread(executar);
+    ativo.store(true, std::memory_order_release);
+}
+
+extern "C" void vc_log_stop(void) {
+    if (!escritor.joinable()) return;
+
+    ativo.store(false, std::memory_order_release);
+    parar.store(true, std::memory_order_release);
+    escritor.join();
+    esvaziar();
+
+    unsigned n = suprimidas.exchange(0, std::memory_order_relaxed);
+    if (n > 0) printf("[%9.3f] %s: %u mensagens suprimidas pelo limite por segundo\n", agora(), nomeNivel(VC_LOG_INFO), n);
+    fflush(stdout);
+}
+
+extern "C" void vc_log_set_level(int level) {
+    nivelAtivo.store(level, std::memory_order_relaxed);
+}
+
+extern "C" int vc_log_get_level(void) {
+    return nivelAtivo.load(std::memory_order_relaxed);
+}
+
+extern "C" void vc_log(int level, const char* fmt, ...) {
+    if (level > nivelAtivo.load(std::memory_order_relaxed)) return;
+
+    va_list args;
+    va_start(args, fmt);
+    registar(level, fmt, args);
+    va_end(args);
+}
+
+extern "C" void vc_log_limited(int level, int max_per_second, const char* fmt, ...) {
+    if (level > nivelAtivo.load(std::memory_order_relaxed)) return;
+
+    // Limite associado ao endereço do formato (colisões partilham o mesmo limite)
+    Limite& limite = limites[((uintptr_t)fmt >> 4) % NUM_LIMITES];
+    long long segundo = (long long)agora();
+
+    if (limite.segundo.load(std::memory_order_relaxed) != segundo ||
+        limite.formato.load(std::memory_order_relaxed) != fmt) {
+        limite.formato.store(fmt, std::memory_order_relaxed);
+        limite.segundo.store(segundo, std::memory_order_relaxed);
+        limite.contagem.store(0, std::memory_order_relaxed);
+    }
+
+    if (limite.contagem.fetch_add(1, std::memory_order_relaxed) >= max_per_second) {
+        suprimidas.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    va_list args;
+    va_start(args, fmt);
+    registar(level, fmt, args);
+    va_end(args);
+}
@@ -0,0 +1,36 @@
+#ifndef VC_LOG_H
+#define VC_LOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//                   REGISTO (LOG) ASSÍNCRONO
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// As mensagens são formatadas diretamente num buffer circular sem locks e escritas
+// na consola por uma thread própria. Com o buffer cheio, as mensagens são descartadas
+// (e contadas) em vez de bloquear quem as regista. Antes de vc_log_start() e depois
+// de vc_log_stop() as mensagens são escritas de imediato.
+
+// Níveis (uma mensagem é registada se o seu nível for <= ao nível ativo)
+#define VC_LOG_ERRO     0
+#define VC_LOG_AVISO    1
+#define VC_LOG_INFO     2
+#define VC_LOG_DEBUG    3
+
+void vc_log_start(int level);
+void vc_log_stop(void);
+void vc_log_set_level(int level);
+int vc_log_get_level(void);
+
+void vc_log(int level, const char* fmt, ...);
+
+// Igual a vc_log(), mas no máximo max_per_second mensagens por segundo com o mesmo fmt
+void vc_log_limited(int level, int max_per_second, const char* fmt, ...);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif